@@ -1,10 +1,14 @@
 #include "Acceptor.h"
 #include "Logger.h"
+#include "LogLimiter.h"
+#include "FlightRecorder.h"
 #include "InetAddr.h"
+#include "EventLoop.h"
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 /**
@@ -14,20 +18,36 @@ Acceptor::Acceptor(EventLoop *loop, const InetAddr &listenAddr, bool reuseport)
     : loop_(loop),
       acceptSocket_(Socket::createNonblockingFd()),
       acceptChannel_(loop, acceptSocket_.fd()),
-      listenning_(false)
+      acceptBatch_(kDefaultAcceptBatch),
+      listenning_(false),
+      completionMode_(false),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+      paused_(false),
+      pauseMs_(kMinPauseMs),
+      numRejected_(0),
+      numPauses_(0)
 {
     acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    acceptSocket_.setReusePort(reuseport);
     acceptSocket_.bindAddress(listenAddr);
     // TcpServer::start() Acceptor.listen  有新用户的连接，要执行一个回调（connfd=》channel=》subloop）
     // baseLoop => acceptChannel_(listenfd) =>
     acceptChannel_.setReadCallBack(std::bind(&Acceptor::handleRead, this));
+    acceptChannel_.setName("Acceptor");
 }
 
 Acceptor::~Acceptor()
 {
+    if (paused_)
+    {
+        loop_->cancel(resumeTimer_);
+    }
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 /**
@@ -38,35 +58,171 @@ void Acceptor::listen()
 {
     listenning_ = true;
     acceptSocket_.listen();
-    acceptChannel_.enableReading();
+    startAccepting();
+}
+
+/**
+ * @brief 开始接受连接：Poller支持完成模式(io_uring)时由它持续accept并交付结果，否则关注监听socket的可读事件
+ */
+void Acceptor::startAccepting()
+{
+    completionMode_ = loop_->startAccept(&acceptChannel_,
+                                         std::bind(&Acceptor::handleAcceptCompletion, this, std::placeholders::_1, std::placeholders::_2),
+                                         std::bind(&Acceptor::handleAcceptBatchEnd, this));
+    if (!completionMode_)
+    {
+        acceptChannel_.enableReading();
+    }
+}
+
+void Acceptor::stopAccepting()
+{
+    if (completionMode_)
+    {
+        loop_->stopCompletion(&acceptChannel_);
+    }
+    else
+    {
+        acceptChannel_.disableReading();
+    }
 }
 
 /**
- * @brief 有新的连接到来
+ * @brief 有新的连接到来.
+ * 一次可读事件最多accept acceptBatch_个连接，直到backlog取空(EAGAIN)，连接风暴时不必每个连接都经过一次epoll_wait；
+ * 设置上限是为了不让accept长时间占住loop。本次的连接都交给回调之后调用acceptBatchDoneCallback_
  */
 void Acceptor::handleRead()
 {
-    InetAddr peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd > 0)
+    for (int i = 0; i < acceptBatch_; ++i)
     {
-        if (newConnectionCallback_)
+        if (!acceptOne())
         {
-            newConnectionCallback_(connfd, peerAddr); // 轮询找到subLoop，唤醒，分发当前的新客户端的Channel
+            break;
         }
-        else
+    }
+    if (acceptBatchDoneCallback_)
+    {
+        acceptBatchDoneCallback_();
+    }
+}
+
+/**
+ * @brief accept一个连接，backlog已空或者出错时返回false
+ */
+bool Acceptor::acceptOne()
+{
+    InetAddr peerAddr;
+    int connfd = acceptSocket_.accept(&peerAddr);
+    if (connfd < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        return false;
+    }
+    FlightRecorder::record(FlightRecorder::kAccept, connfd, connfd < 0 ? errno : 0);
+    if (connfd >= 0)
+    {
+        newConnection(connfd, peerAddr);
+        return true;
+    }
+    handleAcceptError(errno);
+    return false;
+}
+
+/**
+ * @brief io_uring完成模式下Poller交付的一个accept结果
+ */
+void Acceptor::handleAcceptCompletion(int connfd, int savedErrno)
+{
+    FlightRecorder::record(FlightRecorder::kAccept, connfd, savedErrno);
+    if (connfd >= 0)
+    {
+        // multishot accept不带回对端地址
+        InetAddr peerAddr;
+        sockaddr_in addr;
+        socklen_t addrlen = sizeof addr;
+        if (::getpeername(connfd, (sockaddr *)&addr, &addrlen) == 0)
         {
-            close(connfd);
+            peerAddr.setSockaddr(addr);
         }
+        newConnection(connfd, peerAddr);
+    }
+    else
+    {
+        handleAcceptError(savedErrno);
+    }
+}
+
+void Acceptor::handleAcceptBatchEnd()
+{
+    if (acceptBatchDoneCallback_)
+    {
+        acceptBatchDoneCallback_();
+    }
+}
+
+void Acceptor::newConnection(int connfd, const InetAddr &peerAddr)
+{
+    pauseMs_ = kMinPauseMs;
+    if (newConnectionCallback_)
+    {
+        newConnectionCallback_(connfd, peerAddr); // 轮询找到subLoop，唤醒，分发当前的新客户端的Channel
     }
     else
     {
-        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        // EMFILE什么错误？
-        // 进程打开的文件描述符数量超过了系统限制
-        if (errno == EMFILE)
+        close(connfd);
+    }
+}
+
+void Acceptor::handleAcceptError(int savedErrno)
+{
+    // EMFILE什么错误？
+    // 进程打开的文件描述符数量超过了系统限制，ENFILE是整个系统的限制，ENOBUFS/ENOMEM是内核内存不足
+    if (savedErrno == EMFILE || savedErrno == ENFILE || savedErrno == ENOBUFS || savedErrno == ENOMEM)
+    {
+        handleExhausted(savedErrno);
+        return;
+    }
+    // 连接风暴时每次可读事件都可能走到这里，限速避免日志拖慢loop
+    LOG_ERROR_RATELIMIT(10, "%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, savedErrno);
+}
+
+/**
+ * @brief 资源耗尽时accept失败，但连接还留在backlog中，监听socket一直可读，水平触发的epoll会让loop空转、日志刷屏.
+ * fd耗尽时用预留的fd把队首的连接accept出来立即关闭，对端马上收到FIN而不是一直等待；
+ * 然后暂停关注可读事件，由定时器在pauseMs_后恢复，连续耗尽时暂停时长翻倍。
+ * 暂停期间新连接留在backlog中，期间有连接关闭释放了fd的话，恢复后可以正常accept
+ */
+void Acceptor::handleExhausted(int savedErrno)
+{
+    if ((savedErrno == EMFILE || savedErrno == ENFILE) && idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+        int connfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+        if (connfd >= 0)
         {
-            LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
+            ::close(connfd);
+            numRejected_.fetch_add(1, std::memory_order_relaxed);
         }
+        // 其它线程可能抢先用掉了腾出来的位置，失败时在恢复accept时再试
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+
+    paused_ = true;
+    numPauses_.fetch_add(1, std::memory_order_relaxed);
+    stopAccepting();
+    resumeTimer_ = loop_->runAfter(pauseMs_ / 1000.0, std::bind(&Acceptor::resumeAccept, this));
+    LOG_ERROR_RATELIMIT(10, "%s:%s:%d accept err:%d, pause accepting for %d ms, %lld connections rejected \n",
+                        __FILE__, __FUNCTION__, __LINE__, savedErrno, pauseMs_,
+                        static_cast<long long>(numRejected_.load(std::memory_order_relaxed)));
+    pauseMs_ = pauseMs_ * 2 < kMaxPauseMs ? pauseMs_ * 2 : kMaxPauseMs;
+}
+
+void Acceptor::resumeAccept()
+{
+    paused_ = false;
+    if (idleFd_ < 0)
+    {
+        idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
     }
+    startAccepting();
 }
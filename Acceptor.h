@@ -4,6 +4,10 @@
 #include "Channel.h"
 #include <functional>
 #include "Socket.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <stdint.h>
 
 class EventLoop;
 class InetAddress;
@@ -12,6 +16,11 @@ class Acceptor : noncopyable
 {
 public:
     using NewConnectionCB = std::function<void(int sockfd, const InetAddr &)>;
+    using AcceptBatchDoneCB = std::function<void()>;
+
+    static const int kDefaultAcceptBatch = 32;
+    static const int kMinPauseMs = 10;   // fd耗尽后第一次暂停accept的时长
+    static const int kMaxPauseMs = 1000; // 连续耗尽时暂停时长翻倍，最长kMaxPauseMs
 
     Acceptor(EventLoop *loop, const InetAddr &listenAddr, bool reuseport);
     ~Acceptor();
@@ -20,12 +29,30 @@ public:
     {
         newConnectionCallback_ = cb;
     }
+    // 一次可读事件accept的连接都交给NewConnectionCB之后调用，用于批量分发
+    void setAcceptBatchDoneCallback(const AcceptBatchDoneCB &cb) { acceptBatchDoneCallback_ = cb; }
+    // 一次可读事件最多accept的连接数，1表示每次只accept一个。io_uring完成模式下由内核持续accept，不受此限制
+    void setAcceptBatch(int batch) { acceptBatch_ = batch > 0 ? batch : 1; }
 
+    EventLoop *getLoop() const { return loop_; }
     bool listenning() const { return listenning_; }
     void listen();
 
+    // 因为fd耗尽被accept后立即关闭的连接数、暂停accept的次数，可以在任意线程读取
+    int64_t numRejected() const { return numRejected_.load(std::memory_order_relaxed); }
+    int64_t numPauses() const { return numPauses_.load(std::memory_order_relaxed); }
+
 private:
     void handleRead();
+    bool acceptOne();
+    void newConnection(int connfd, const InetAddr &peerAddr);
+    void handleAcceptError(int savedErrno);
+    void startAccepting();
+    void stopAccepting();
+    void handleAcceptCompletion(int connfd, int savedErrno);
+    void handleAcceptBatchEnd();
+    void handleExhausted(int savedErrno);
+    void resumeAccept();
     // Acceptor用的就是用户定义的那个baseLoop，也称作mainLoop
     EventLoop *loop_;
     Socket acceptSocket_;
@@ -36,5 +63,18 @@ private:
      *  该回调函数会在TcpServer::newConnection中被设置-用于打包新连接的Channel、封装到subLoop中（fd-->channel)
      */
     NewConnectionCB newConnectionCallback_;
+    AcceptBatchDoneCB acceptBatchDoneCallback_;
+    int acceptBatch_;
     bool listenning_;
+    bool completionMode_; // Poller支持完成模式时由Poller代为accept，不关注可读事件
+
+    /**
+     * @brief 预留的空闲fd(/dev/null)。fd用完时先关掉它腾出一个位置，把backlog中的连接accept出来立即关闭，再重新占住
+     */
+    int idleFd_;
+    bool paused_;         // fd耗尽后暂时不关注监听socket的可读事件
+    int pauseMs_;         // 下一次暂停的时长，成功accept后恢复为kMinPauseMs
+    TimerId resumeTimer_; // 暂停结束时恢复accept的定时器
+    std::atomic<int64_t> numRejected_;
+    std::atomic<int64_t> numPauses_;
 };
@@ -0,0 +1,508 @@
+#include "AsyncLogging.h"
+#include "BinaryLog.h"
+#include "CurrentThread.h"
+#include "LogFile.h"
+#include "LogRing.h"
+#include "Logger.h"
+#include "Timestamp.h"
+#include "TimestampFormatter.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+
+std::atomic<AsyncLogging *> AsyncLogging::s_installed_(nullptr);
+std::atomic<int> AsyncLogging::s_activeCalls_(0);
+
+namespace
+{
+    std::atomic<uint64_t> g_nextId(1);
+
+    /**
+     * @brief 线程局部的环。线程退出时关闭它，AsyncLogging的后端读完剩余记录后释放
+     */
+    struct ThreadRing
+    {
+        uint64_t ownerId = 0; // 所属AsyncLogging的id_
+        std::shared_ptr<LogRing> ring;
+
+        ~ThreadRing()
+        {
+            if (ring)
+            {
+                ring->close();
+            }
+        }
+    };
+
+    thread_local ThreadRing t_ring;
+
+    /**
+     * @brief installed*的调用期间计数，与~AsyncLogging中置空s_installed_配合，
+     * 两边都用seq_cst：要么调用者读到nullptr，要么析构函数等到调用结束
+     */
+    struct ActiveCall
+    {
+        std::atomic<int> *count;
+
+        explicit ActiveCall(std::atomic<int> *c) : count(c) { count->fetch_add(1); }
+        ~ActiveCall() { count->fetch_sub(1); }
+    };
+
+    /**
+     * @brief 归并时每个环的读取位置
+     */
+    struct Cursor
+    {
+        LogRing *ring;
+        uint64_t limit;
+        LogRing::Record record;
+    };
+
+    template <typename T>
+    void appendValue(std::string *entry, T value)
+    {
+        entry->append(reinterpret_cast<const char *>(&value), sizeof value);
+    }
+
+    void appendBytes(std::string *entry, const char *data, size_t len)
+    {
+        appendValue(entry, static_cast<uint32_t>(len));
+        entry->append(data, len);
+    }
+}
+
+AsyncLogging::AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval, size_t ringSize)
+    : flushInterval_(flushInterval),
+      ringSize_(ringSize),
+      id_(g_nextId.fetch_add(1)),
+      running_(false),
+      basename_(basename),
+      rollSize_(rollSize),
+      policy_(kDrop),
+      fileFormat_(kText),
+      thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging"),
+      droppedReported_(0),
+      lastDropReport_(0),
+      droppedRetired_(0),
+      fileRolls_(0),
+      wakeupPending_(false),
+      started_(false),
+      flushRequested_(0),
+      flushCompleted_(0)
+{
+}
+
+/**
+ * @brief 其它线程可能已经取到installed*，还没有读s_installed_。先把s_installed_置空，
+ * 再等已经读到它的调用返回，之后不会再有线程访问当前对象。
+ * 后端在这之后才停止，等待中的kBlock调用和最后追加的日志都能写完
+ */
+AsyncLogging::~AsyncLogging()
+{
+    AsyncLogging *self = this;
+    if (s_installed_.compare_exchange_strong(self, nullptr))
+    {
+        Logger::setOutput(nullptr);
+        Logger::setFlush(nullptr);
+        BinaryLog::setOutput(nullptr);
+        while (s_activeCalls_.load() != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+    // 等后端线程开始运行，之后的flush()一定有人响应
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return started_; });
+}
+
+void AsyncLogging::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+void AsyncLogging::install()
+{
+    s_installed_.store(this);
+    Logger::setOutput(&AsyncLogging::installedOutput);
+    Logger::setFlush(&AsyncLogging::installedFlush);
+    BinaryLog::setOutput(&AsyncLogging::installedBinaryOutput);
+}
+
+uint64_t AsyncLogging::droppedMessages() const
+{
+    uint64_t dropped = droppedRetired_.load(std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(ringsMutex_);
+    for (const RingPtr &ring : rings_)
+    {
+        dropped += ring->dropped();
+    }
+    return dropped;
+}
+
+/**
+ * @brief 当前线程的环，第一次调用时创建并注册
+ */
+LogRing *AsyncLogging::ringOfThisThread()
+{
+    if (t_ring.ownerId != id_)
+    {
+        if (t_ring.ring)
+        {
+            t_ring.ring->close(); // 之前属于另一个AsyncLogging
+        }
+        RingPtr ring(new LogRing(ringSize_, CurrentThread::tid()));
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            rings_.push_back(ring);
+        }
+        t_ring.ring = ring;
+        t_ring.ownerId = id_;
+    }
+    return t_ring.ring.get();
+}
+
+void AsyncLogging::wakeupBackend()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    cond_.notify_one();
+}
+
+/**
+ * @brief 前端：写入当前线程的环，不加锁。环超过一半时唤醒后端，写满时按OverflowPolicy处理
+ */
+void AsyncLogging::append(const char *logline, size_t len, bool mustNotDrop)
+{
+    push(kTextRecord, logline, len, mustNotDrop);
+}
+
+/**
+ * @brief 格式id和参数拼成一条记录，格式化留给后端
+ */
+void AsyncLogging::appendBinary(int formatId, const char *args, size_t len)
+{
+    char record[sizeof(int32_t) + BinaryLog::kMaxArgBytes];
+    const int32_t id = formatId;
+    memcpy(record, &id, sizeof id);
+    memcpy(record + sizeof id, args, len);
+    push(kBinaryRecord, record, sizeof id + len, false);
+}
+
+void AsyncLogging::push(uint32_t type, const char *data, size_t len, bool mustNotDrop)
+{
+    LogRing *ring = ringOfThisThread();
+    const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    while (!ring->tryPush(now, data, len, type))
+    {
+        bool block = mustNotDrop || policy_.load(std::memory_order_relaxed) == kBlock;
+        if (!block || !running_)
+        {
+            ring->addDropped();
+            return;
+        }
+        if (!wakeupPending_.exchange(true))
+        {
+            wakeupBackend();
+        }
+        std::this_thread::yield();
+    }
+    if (ring->overHalfFull() && !wakeupPending_.load(std::memory_order_relaxed) && !wakeupPending_.exchange(true))
+    {
+        wakeupBackend();
+    }
+}
+
+/**
+ * @brief 阻塞到调用之前追加的日志全部写入文件并flush。后端线程没有运行时直接返回
+ */
+void AsyncLogging::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!started_ || !running_)
+    {
+        return;
+    }
+    const int64_t request = ++flushRequested_;
+    cond_.notify_one();
+    flushedCond_.wait(lock, [this, request]() { return flushCompleted_ >= request || !running_; });
+}
+
+/**
+ * @brief 先记下每个环当前的head，再按时间戳k路归并到这些位置为止。
+ * 之后写入的记录留到下一轮，一直在写的线程不会让其它线程饿死。线程数不多，每次线性查找最小值
+ */
+void AsyncLogging::drainRings(const RingList &rings, LogFile *output)
+{
+    std::vector<Cursor> cursors;
+    cursors.reserve(rings.size());
+    for (const RingPtr &ring : rings)
+    {
+        Cursor cursor;
+        cursor.ring = ring.get();
+        cursor.limit = ring->head();
+        if (cursor.ring->peek(cursor.limit, &cursor.record))
+        {
+            cursors.push_back(cursor);
+        }
+    }
+
+    while (!cursors.empty())
+    {
+        size_t earliest = 0;
+        for (size_t i = 1; i < cursors.size(); ++i)
+        {
+            if (cursors[i].record.microSecondsSinceEpoch < cursors[earliest].record.microSecondsSinceEpoch)
+            {
+                earliest = i;
+            }
+        }
+        Cursor &cursor = cursors[earliest];
+        const LogRing::Record &record = cursor.record;
+        if (record.type == kBinaryRecord)
+        {
+            writeBinary(output, record.microSecondsSinceEpoch, record.data, record.len);
+        }
+        else
+        {
+            writeText(output, record.data, record.len);
+        }
+        cursor.ring->pop();
+        if (!cursor.ring->peek(cursor.limit, &cursor.record))
+        {
+            cursors[earliest] = cursors.back();
+            cursors.pop_back();
+        }
+    }
+}
+
+/**
+ * @brief 报告新增的丢弃数，释放写入线程已经退出并且读完的环，rings得到剩下的环的快照
+ */
+void AsyncLogging::reapRings(RingList *rings, LogFile *output)
+{
+    uint64_t dropped = 0;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex_);
+        for (size_t i = 0; i < rings_.size();)
+        {
+            LogRing *ring = rings_[i].get();
+            if (ring->closed() && ring->empty())
+            {
+                droppedRetired_.fetch_add(ring->dropped(), std::memory_order_relaxed);
+                rings_[i] = rings_.back();
+                rings_.pop_back();
+            }
+            else
+            {
+                dropped += ring->dropped();
+                ++i;
+            }
+        }
+        dropped += droppedRetired_.load(std::memory_order_relaxed);
+        *rings = rings_;
+    }
+
+    // 持续丢弃时每秒最多报告一次
+    const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    if (dropped > droppedReported_ && now - lastDropReport_ >= Timestamp::kMicroSecondsPerSecond)
+    {
+        lastDropReport_ = now;
+        char buf[128];
+        size_t len = strlen("[ERROR]");
+        memcpy(buf, "[ERROR]", len);
+        len += TimestampFormatter::format(Timestamp(now), TimestampFormatter::kSlash, false, buf + len);
+        len += snprintf(buf + len, sizeof buf - len, " : AsyncLogging dropped %llu log messages\n",
+                        static_cast<unsigned long long>(dropped - droppedReported_));
+        fwrite(buf, 1, len, stderr);
+        writeText(output, buf, len);
+        droppedReported_ = dropped;
+    }
+}
+
+/**
+ * @brief 二进制文件：开始组装一个条目，换了新文件时先写文件头
+ */
+void AsyncLogging::beginEntry(LogFile *output)
+{
+    entry_.clear();
+    if (output->rollCount() != fileRolls_)
+    {
+        fileRolls_ = output->rollCount();
+        formatsInFile_.assign(formatsInFile_.size(), false);
+        entry_.append(BinaryLog::kFileMagic, sizeof BinaryLog::kFileMagic - 1);
+    }
+}
+
+void AsyncLogging::writeText(LogFile *output, const char *logline, size_t len)
+{
+    if (fileFormat_ == kText)
+    {
+        output->append(logline, len);
+        return;
+    }
+    beginEntry(output);
+    entry_.push_back(BinaryLog::kTextEntry);
+    appendBytes(&entry_, logline, len);
+    output->append(entry_.data(), entry_.size());
+}
+
+/**
+ * @brief kText时在这里格式化成与Logger相同的一行；kBinary时原样写出，
+ * 当前文件还没有这个格式时先写出格式条目，两者在同一次append中，滚动不会把它们分到两个文件
+ */
+void AsyncLogging::writeBinary(LogFile *output, int64_t microSecondsSinceEpoch, const char *record, size_t len)
+{
+    int32_t id = -1;
+    if (len >= sizeof id)
+    {
+        memcpy(&id, record, sizeof id);
+    }
+    const BinaryLog::Format *format = BinaryLog::format(id);
+    if (format == nullptr)
+    {
+        return;
+    }
+    const char *args = record + sizeof id;
+    const size_t argsLen = len - sizeof id;
+
+    if (fileFormat_ == kText)
+    {
+        char line[1024 + 64];
+        const char *tag = Logger::levelTag(format->level);
+        size_t n = strlen(tag);
+        memcpy(line, tag, n);
+        n += TimestampFormatter::format(Timestamp(microSecondsSinceEpoch), TimestampFormatter::kSlash, false, line + n);
+        memcpy(line + n, " : ", 3);
+        n += 3;
+        n += BinaryLog::formatArgs(format->fmt, format->signature, args, argsLen, line + n, sizeof line - n - 1);
+        line[n++] = '\n';
+        output->append(line, n);
+        return;
+    }
+
+    beginEntry(output);
+    if (static_cast<size_t>(id) >= formatsInFile_.size())
+    {
+        formatsInFile_.resize(id + 1, false);
+    }
+    if (!formatsInFile_[id])
+    {
+        formatsInFile_[id] = true;
+        entry_.push_back(BinaryLog::kFormatEntry);
+        appendValue(&entry_, id);
+        appendValue(&entry_, static_cast<int32_t>(format->level));
+        appendValue(&entry_, static_cast<int32_t>(format->line));
+        appendBytes(&entry_, format->fmt, strlen(format->fmt));
+        appendBytes(&entry_, format->file, strlen(format->file));
+        appendBytes(&entry_, format->signature, strlen(format->signature));
+    }
+    entry_.push_back(BinaryLog::kBinaryEntry);
+    appendValue(&entry_, microSecondsSinceEpoch);
+    appendValue(&entry_, id);
+    appendBytes(&entry_, args, argsLen);
+    output->append(entry_.data(), entry_.size());
+}
+
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, flushInterval_);
+    RingList rings;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        started_ = true;
+    }
+    cond_.notify_all();
+
+    bool running = true;
+    while (running)
+    {
+        int64_t flushRequest;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!wakeupPending_ && flushRequested_ == flushCompleted_ && running_)
+            {
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            wakeupPending_ = false;
+            // stop()之后还要把剩下的日志写完再退出
+            running = running_;
+            flushRequest = flushRequested_;
+        }
+
+        reapRings(&rings, &output);
+        drainRings(rings, &output);
+        if (!running)
+        {
+            lastDropReport_ = 0; // 退出前报告剩下的丢弃数
+            reapRings(&rings, &output);
+        }
+        output.flush();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            flushCompleted_ = flushRequest;
+        }
+        flushedCond_.notify_all();
+    }
+    output.flush();
+}
+
+void AsyncLogging::installedOutput(int level, const char *msg, size_t len)
+{
+    ActiveCall call(&s_activeCalls_);
+    AsyncLogging *log = s_installed_.load();
+    if (log != nullptr)
+    {
+        log->append(msg, len, level == FATAL);
+    }
+    else
+    {
+        fwrite(msg, 1, len, stdout); // 已经卸载，与Logger的默认输出相同
+    }
+}
+
+void AsyncLogging::installedBinaryOutput(int level, int formatId, const char *args, size_t len)
+{
+    ActiveCall call(&s_activeCalls_);
+    AsyncLogging *log = s_installed_.load();
+    if (log != nullptr)
+    {
+        log->appendBinary(formatId, args, len);
+        return;
+    }
+    const BinaryLog::Format *format = BinaryLog::format(formatId);
+    char message[1024];
+    BinaryLog::formatArgs(format->fmt, format->signature, args, len, message, sizeof message);
+    Logger::log(level, message);
+}
+
+void AsyncLogging::installedFlush()
+{
+    ActiveCall call(&s_activeCalls_);
+    AsyncLogging *log = s_installed_.load();
+    if (log != nullptr)
+    {
+        log->flush();
+    }
+    else
+    {
+        fflush(stdout);
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+class LogRing;
+class LogFile;
+
+/**
+ * @brief 异步日志的后端。
+ * 每个写日志的线程(各个EventLoopThread、工作线程)第一次写日志时注册一个自己的LogRing，
+ * append只写本线程的无锁SPSC环，线程之间不竞争任何锁；
+ * 后端线程轮流读取所有环，按时间戳归并后写入滚动的LogFile。
+ * 环写满时按OverflowPolicy处理：kDrop(默认)丢弃并计数，写日志的线程永远不会阻塞，loop线程应使用它；
+ * kBlock唤醒后端并等待空间，不丢日志，只适合不在loop中的工作线程。
+ * 有日志被丢弃时后端会写一条提示，droppedMessages()返回累计的丢弃数。
+ * flush()阻塞到调用之前追加的日志全部写入文件，LOG_FATAL通过它保证日志不丢。
+ * 二进制日志(LOGB_*)只把格式id和参数写入环，由后端线程格式化成文本；
+ * FileFormat为kBinary时后端也不格式化，原样写入文件，之后用log_decoder解码。
+ *
+ * 用法：
+ *   AsyncLogging log("/tmp/server", 500 * 1000 * 1000);
+ *   log.start();
+ *   log.install(); // Logger的输出改为log
+ */
+class AsyncLogging : noncopyable
+{
+public:
+    enum OverflowPolicy
+    {
+        kDrop,  // 丢弃这条日志并计数
+        kBlock, // 等待后端腾出空间
+    };
+
+    enum FileFormat
+    {
+        kText,   // 文本文件，二进制日志由后端格式化
+        kBinary, // 二进制文件，格式见BinaryLog.h
+    };
+
+    /**
+     * @param ringSize 每个线程的环形缓冲区的字节数
+     */
+    AsyncLogging(const std::string &basename, off_t rollSize, int flushInterval = 3, size_t ringSize = 1024 * 1024);
+    ~AsyncLogging();
+
+    /**
+     * @brief 追加一条日志到当前线程的环
+     * @param mustNotDrop 为true时不论OverflowPolicy都等待空间，LOG_FATAL使用
+     */
+    void append(const char *logline, size_t len, bool mustNotDrop = false);
+    // 追加一条二进制日志，args是BinaryLog编码后的参数
+    void appendBinary(int formatId, const char *args, size_t len);
+    void flush();
+
+    void start();
+    void stop();
+
+    /**
+     * @brief 把Logger和BinaryLog的输出以及flush函数设置为当前对象。
+     * 析构时先恢复默认输出，等正在调用installed*的线程返回，再停止后端写完剩下的日志
+     */
+    void install();
+
+    // 日志文件的格式，只能在start()之前设置
+    void setFileFormat(FileFormat format) { fileFormat_ = format; }
+
+    // 环写满时的处理方式，可以在任意线程设置
+    void setOverflowPolicy(OverflowPolicy policy) { policy_.store(policy, std::memory_order_relaxed); }
+    // 因为环写满而丢弃的日志条数
+    uint64_t droppedMessages() const;
+
+private:
+    using RingPtr = std::shared_ptr<LogRing>;
+    using RingList = std::vector<RingPtr>;
+
+    // 环中记录的类型
+    enum RecordType : uint32_t
+    {
+        kTextRecord,   // 格式化好的一行
+        kBinaryRecord, // int32格式id加上编码后的参数
+    };
+
+    void threadFunc();
+    LogRing *ringOfThisThread();
+    void push(uint32_t type, const char *data, size_t len, bool mustNotDrop);
+    // 按时间戳归并写出所有环中limits之前的记录
+    void drainRings(const RingList &rings, LogFile *output);
+    // 写出新增的丢弃数，释放已经关闭并读完的环
+    void reapRings(RingList *rings, LogFile *output);
+    // 后端按文件格式写出一行文本和一条二进制日志
+    void beginEntry(LogFile *output);
+    void writeText(LogFile *output, const char *logline, size_t len);
+    void writeBinary(LogFile *output, int64_t microSecondsSinceEpoch, const char *record, size_t len);
+    void wakeupBackend();
+    // install()之后Logger的输出和flush函数
+    static void installedOutput(int level, const char *msg, size_t len);
+    static void installedFlush();
+    static void installedBinaryOutput(int level, int formatId, const char *args, size_t len);
+
+    const int flushInterval_;
+    const size_t ringSize_;
+    const uint64_t id_; // 区分不同的AsyncLogging对象，线程局部的环属于哪个对象
+    std::atomic_bool running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    std::atomic<int> policy_;
+    FileFormat fileFormat_;
+    Thread thread_;
+
+    mutable std::mutex ringsMutex_; // 保护rings_，只在注册新线程和后端取快照时加锁
+    RingList rings_;
+    uint64_t droppedReported_;             // 后端已经报告的丢弃数，包括已经释放的环
+    int64_t lastDropReport_;               // 上一次报告丢弃的时间
+    std::atomic<uint64_t> droppedRetired_; // 已经释放的环的丢弃数
+
+    // 以下只由后端线程使用
+    std::string entry_;                 // 正在组装的条目，一次append写出，不会被滚动拆到两个文件
+    int64_t fileRolls_;                 // 已经写过文件头的文件数，与LogFile::rollCount()不同时说明换了新文件
+    std::vector<bool> formatsInFile_;   // 当前文件已经写过的格式
+
+    std::mutex mutex_;
+    std::condition_variable cond_;        // 唤醒后端线程
+    std::condition_variable flushedCond_; // 通知flush()的调用者
+    std::atomic_bool wakeupPending_;      // 已经有人唤醒后端，避免每条日志都notify
+    bool started_;                        // 后端线程已经开始运行，用mutex_保护
+    int64_t flushRequested_;              // 请求flush的次数
+    int64_t flushCompleted_;              // 后端已经完成的flush请求
+
+    static std::atomic<AsyncLogging *> s_installed_; // install()的对象
+    static std::atomic<int> s_activeCalls_;          // 正在installed*中使用s_installed_的调用数
+};
@@ -0,0 +1,327 @@
+#include "BinaryLog.h"
+
+#include <mutex>
+#include <string>
+#include <stdio.h>
+
+constexpr char BinaryLog::kFileMagic[];
+std::atomic<int> BinaryLog::s_numFormats_(0);
+
+namespace
+{
+    BinaryLog::Format g_formats[BinaryLog::kMaxFormats];
+    std::mutex g_registerMutex;
+    std::atomic<BinaryLog::OutputFunc> g_output(nullptr);
+
+    // printf的长度修饰符，重新格式化时去掉，按保存的类型换成合适的修饰符
+    bool isLengthModifier(char c)
+    {
+        return c == 'h' || c == 'l' || c == 'L' || c == 'q' || c == 'j' || c == 'z' || c == 't';
+    }
+
+    bool isConversion(char c)
+    {
+        return strchr("diouxXeEfFgGaAcspn", c) != nullptr;
+    }
+
+    // 长度修饰符规定的整数宽度(字节)，没有修饰符时是int
+    size_t modifierWidth(const char *length, size_t n)
+    {
+        if (n == 0)
+        {
+            return sizeof(int);
+        }
+        switch (length[0])
+        {
+        case 'h':
+            return n == 2 ? sizeof(char) : sizeof(short);
+        case 'l':
+            return n == 2 ? sizeof(long long) : sizeof(long);
+        case 'z':
+            return sizeof(size_t);
+        case 't':
+            return sizeof(ptrdiff_t);
+        default: // q、j、L
+            return sizeof(long long);
+        }
+    }
+
+    // 与printf一样把整数截断为width字节，再按转换字符的符号扩展回64位
+    int64_t narrowTo(int64_t value, size_t width, bool isSigned)
+    {
+        if (width >= sizeof(int64_t))
+        {
+            return value;
+        }
+        const uint64_t mask = (uint64_t(1) << (width * 8)) - 1;
+        uint64_t bits = static_cast<uint64_t>(value) & mask;
+        if (isSigned && (bits >> (width * 8 - 1)) != 0)
+        {
+            bits |= ~mask;
+        }
+        return static_cast<int64_t>(bits);
+    }
+
+    /**
+     * @brief 读出一个参数，返回是否还有足够的数据
+     */
+    template <typename T>
+    bool readValue(const char **args, const char *end, T *value)
+    {
+        if (static_cast<size_t>(end - *args) < sizeof(T))
+        {
+            return false;
+        }
+        memcpy(value, *args, sizeof(T));
+        *args += sizeof(T);
+        return true;
+    }
+
+    void appendText(char *out, size_t outLen, size_t *pos, const char *text, size_t n)
+    {
+        if (*pos + 1 >= outLen)
+        {
+            return;
+        }
+        size_t room = outLen - 1 - *pos;
+        if (n > room)
+        {
+            n = room;
+        }
+        memcpy(out + *pos, text, n);
+        *pos += n;
+    }
+
+    // 用spec格式化一个值并追加到out
+    template <typename T>
+    void appendFormatted(char *out, size_t outLen, size_t *pos, const char *spec, T value)
+    {
+        if (*pos + 1 >= outLen)
+        {
+            return;
+        }
+        int n = snprintf(out + *pos, outLen - *pos, spec, value);
+        if (n > 0)
+        {
+            *pos += static_cast<size_t>(n) < outLen - *pos ? static_cast<size_t>(n) : outLen - 1 - *pos;
+        }
+    }
+}
+
+void BinaryLog::checkFormat(const char *, ...)
+{
+}
+
+/**
+ * @brief 不内联：变长的memcpy内联后gcc会生成rep movs，短字符串上比调用libc的memcpy慢几倍
+ */
+void BinaryLog::encodeString(char *buf, size_t *len, const char *str)
+{
+    size_t room = kMaxArgBytes - *len;
+    if (room < sizeof(uint32_t))
+    {
+        return;
+    }
+    room -= sizeof(uint32_t);
+    const size_t n = strlen(str);
+    uint32_t size = static_cast<uint32_t>(n < room ? n : room);
+    memcpy(buf + *len, &size, sizeof size);
+    memcpy(buf + *len + sizeof size, str, size);
+    *len += sizeof size + size;
+}
+
+void BinaryLog::setOutput(OutputFunc out)
+{
+    g_output.store(out, std::memory_order_release);
+}
+
+int BinaryLog::registerFormat(int level, const char *fmt, const char *file, int line, const char *signature)
+{
+    std::lock_guard<std::mutex> lock(g_registerMutex);
+    int id = s_numFormats_.load(std::memory_order_relaxed);
+    if (id >= kMaxFormats)
+    {
+        return -1;
+    }
+    Format &format = g_formats[id];
+    format.level = level;
+    format.fmt = fmt;
+    format.file = file;
+    format.line = line;
+    format.signature = signature;
+    // 先写好格式再发布，后端不加锁读取
+    s_numFormats_.store(id + 1, std::memory_order_release);
+    return id;
+}
+
+const BinaryLog::Format *BinaryLog::format(int id)
+{
+    if (id < 0 || id >= s_numFormats_.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+    return &g_formats[id];
+}
+
+void BinaryLog::write(int formatId, const char *args, size_t len)
+{
+    const Format *fmt = format(formatId);
+    if (fmt == nullptr)
+    {
+        return; // 注册表已满的调用处
+    }
+    OutputFunc out = g_output.load(std::memory_order_acquire);
+    if (out != nullptr)
+    {
+        out(fmt->level, formatId, args, len);
+        return;
+    }
+    // 没有二进制输出，直接格式化
+    char message[1024];
+    formatArgs(fmt->fmt, fmt->signature, args, len, message, sizeof message);
+    Logger::log(fmt->level, message);
+}
+
+/**
+ * @brief 逐个解析格式串中的转换说明，去掉原来的长度修饰符，按签名中保存的类型重新组合后交给snprintf。
+ * 整数先按原来的长度修饰符截断，所以%x、%u、%hd、%hhu的结果与LOG_*相同
+ */
+size_t BinaryLog::formatArgs(const char *fmt, const char *signature, const char *args, size_t len,
+                             char *out, size_t outLen)
+{
+    const char *end = args + len;
+    size_t pos = 0;
+    const char *p = fmt;
+    while (*p != '\0')
+    {
+        const char *percent = strchr(p, '%');
+        if (percent == nullptr)
+        {
+            appendText(out, outLen, &pos, p, strlen(p));
+            break;
+        }
+        appendText(out, outLen, &pos, p, percent - p);
+        if (percent[1] == '%')
+        {
+            appendText(out, outLen, &pos, "%", 1);
+            p = percent + 2;
+            continue;
+        }
+
+        // spec: '%'、标志、宽度、精度，之后补上修饰符和转换字符
+        char spec[32];
+        size_t specLen = 0;
+        char length[4];
+        size_t lengthLen = 0;
+        const char *q = percent;
+        while (*q != '\0' && !isConversion(*q) && specLen + 4 < sizeof spec)
+        {
+            if (!isLengthModifier(*q))
+            {
+                spec[specLen++] = *q;
+            }
+            else if (lengthLen < sizeof length)
+            {
+                length[lengthLen++] = *q;
+            }
+            ++q;
+        }
+        if (!isConversion(*q))
+        {
+            appendText(out, outLen, &pos, percent, strlen(percent)); // 不完整的转换说明，原样输出
+            break;
+        }
+        const char conversion = *q;
+        p = q + 1;
+
+        const char code = *signature;
+        if (code == '\0')
+        {
+            appendText(out, outLen, &pos, "<missing>", 9);
+            continue;
+        }
+        ++signature;
+
+        bool ok = true;
+        if (code == kInt32 || code == kUInt32 || code == kInt64 || code == kUInt64)
+        {
+            int64_t v = 0;
+            size_t width = sizeof v;
+            if (code == kInt32)
+            {
+                int32_t v32 = 0;
+                ok = readValue(&args, end, &v32);
+                v = v32;
+                width = sizeof v32;
+            }
+            else if (code == kUInt32)
+            {
+                uint32_t v32 = 0;
+                ok = readValue(&args, end, &v32);
+                v = v32;
+                width = sizeof v32;
+            }
+            else
+            {
+                ok = readValue(&args, end, &v);
+            }
+            // 修饰符比实参宽时(格式检查会报警告)保持实参的值
+            const size_t modWidth = modifierWidth(length, lengthLen);
+            if (strchr("diouxX", conversion) != nullptr && modWidth <= width)
+            {
+                v = narrowTo(v, modWidth, conversion == 'd' || conversion == 'i');
+            }
+            if (conversion == 'c')
+            {
+                spec[specLen++] = 'c';
+                spec[specLen] = '\0';
+                appendFormatted(out, outLen, &pos, spec, static_cast<int>(v));
+            }
+            else
+            {
+                spec[specLen++] = 'l';
+                spec[specLen++] = 'l';
+                spec[specLen++] = strchr("diouxX", conversion) ? conversion : (code == kInt32 || code == kInt64 ? 'd' : 'u');
+                spec[specLen] = '\0';
+                appendFormatted(out, outLen, &pos, spec, static_cast<long long>(v));
+            }
+        }
+        else if (code == kDouble)
+        {
+            double v = 0;
+            ok = readValue(&args, end, &v);
+            spec[specLen++] = strchr("eEfFgGaA", conversion) ? conversion : 'g';
+            spec[specLen] = '\0';
+            appendFormatted(out, outLen, &pos, spec, v);
+        }
+        else if (code == kPointer)
+        {
+            uint64_t v = 0;
+            ok = readValue(&args, end, &v);
+            spec[specLen++] = 'p';
+            spec[specLen] = '\0';
+            appendFormatted(out, outLen, &pos, spec, reinterpret_cast<void *>(static_cast<uintptr_t>(v)));
+        }
+        else if (code == kString)
+        {
+            uint32_t size = 0;
+            ok = readValue(&args, end, &size) && static_cast<size_t>(end - args) >= size;
+            if (ok)
+            {
+                // 字符串不以'\0'结尾，用精度限制长度；格式串自带精度时取两者中较小的
+                std::string str(args, size);
+                args += size;
+                spec[specLen++] = 's';
+                spec[specLen] = '\0';
+                appendFormatted(out, outLen, &pos, spec, str.c_str());
+            }
+        }
+        if (!ok)
+        {
+            appendText(out, outLen, &pos, "<truncated>", 11);
+            break;
+        }
+    }
+    out[pos] = '\0';
+    return pos;
+}
@@ -0,0 +1,265 @@
+#pragma once
+#include "noncopyable.h"
+#include "Logger.h"
+
+#include <atomic>
+#include <type_traits>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+二进制日志：调用处只保存格式串的id和参数的原始字节，格式化推迟到异步日志的后端线程或者离线解码工具(log_decoder)。
+  LOGB_INFO("conn %s recv %d bytes", name.c_str(), n);
+每个调用处有一个静态的格式描述(级别、格式串、文件、行号、参数类型签名)，第一次执行时注册得到id。
+参数类型由变参模板在编译期编码为签名，不支持的类型编译失败；格式串与参数的匹配由printf的format属性检查。
+整数按提升后的宽度保存(int及更窄的类型4字节，其余8字节)、浮点按double保存，字符串(const char*)拷贝内容，其它指针只保存地址。
+std::string与LOG_*一样要传c_str()，直接传入会编译失败。
+格式串中不支持'*'宽度和精度，不支持%n。
+没有安装二进制输出(AsyncLogging::install)时在调用线程中直接格式化，输出与LOG_*相同
+*/
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOGB_INFO(LogmsgFormat, ...) MUDUO_LOGB_IF(INFO, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOGB_INFO(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define LOGB_ERROR(LogmsgFormat, ...) MUDUO_LOGB_IF(ERR, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOGB_ERROR(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+#define LOGB_DEBUG(LogmsgFormat, ...) MUDUO_LOGB_IF(DEBUG, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOGB_DEBUG(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+// decltype中的调用不会被求值，只用来推导参数类型
+#define MUDUO_LOGB_IF(level, LogmsgFormat, ...)                                                          \
+    do                                                                                                   \
+    {                                                                                                    \
+        if (Logger::enabled(level))                                                                      \
+        {                                                                                                \
+            if (false)                                                                                   \
+            {                                                                                            \
+                BinaryLog::checkFormat(LogmsgFormat, ##__VA_ARGS__);                                     \
+            }                                                                                            \
+            static const int muduoLogFormatId = BinaryLog::registerFormat(                               \
+                level, LogmsgFormat, __FILE__, __LINE__,                                                 \
+                decltype(BinaryLog::signatureOf(__VA_ARGS__))::str());                                   \
+            BinaryLog::log(muduoLogFormatId, ##__VA_ARGS__);                                             \
+        }                                                                                                \
+    } while (0)
+
+/**
+ * @brief 二进制日志的格式注册表、参数编码和解码
+ */
+class BinaryLog : noncopyable
+{
+public:
+    // 参数类型在签名中的编码
+    enum ArgCode : char
+    {
+        kInt32 = 'I', // 提升后是int的整数：int及更窄的类型、bool、枚举
+        kUInt32 = 'U',
+        kInt64 = 'i',
+        kUInt64 = 'u',
+        kDouble = 'd',
+        kString = 's',
+        kPointer = 'p',
+    };
+
+    /**
+     * @brief 一个调用处的格式描述，注册后不再改变
+     */
+    struct Format
+    {
+        int level;
+        const char *fmt;
+        const char *file;
+        int line;
+        const char *signature; // 每个参数一个ArgCode
+    };
+
+    static const int kMaxFormats = 1 << 16;
+    static const size_t kMaxArgBytes = 1024; // 一条日志的参数最多占用的字节数，超长的字符串被截断
+
+    /**
+     * @brief 二进制日志的输出函数，args是编码后的参数
+     */
+    using OutputFunc = void (*)(int level, int formatId, const char *args, size_t len);
+
+    /*
+    二进制日志文件(AsyncLogging::kBinary)的格式，由log_decoder解码。
+    文件头是kFileMagic，之后是一串条目，每条以一个字节的类型开头，整数都是本机字节序：
+      'F' 格式：int32 id, int32 级别, int32 行号, 然后fmt、file、signature各是uint32长度加内容
+      'B' 日志：int64 微秒时间戳, int32 格式id, uint32 参数长度, 参数
+      'T' 文本：uint32 长度, 一行已经格式化好的日志(LOG_*写的日志)
+    每个文件在第一次用到某个格式时写出它的'F'条目，滚动后的文件可以单独解码
+    */
+    static constexpr char kFileMagic[] = "MUDUOBL1";
+    enum EntryType : char
+    {
+        kFormatEntry = 'F',
+        kBinaryEntry = 'B',
+        kTextEntry = 'T',
+    };
+
+    // 设置输出函数，nullptr表示在调用线程中格式化后交给Logger
+    static void setOutput(OutputFunc out);
+
+    /**
+     * @brief 注册一个格式，返回id。注册表满时返回-1，之后这个调用处的日志被忽略
+     */
+    static int registerFormat(int level, const char *fmt, const char *file, int line, const char *signature);
+
+    /**
+     * @brief 按id查找格式，不加锁，id无效时返回nullptr
+     */
+    static const Format *format(int id);
+
+    // 已经注册的格式数
+    static int numFormats() { return s_numFormats_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief 按格式串和签名把编码后的参数格式化成消息，返回写入的长度(不超过outLen - 1)，out以'\0'结尾
+     */
+    static size_t formatArgs(const char *fmt, const char *signature, const char *args, size_t len,
+                             char *out, size_t outLen);
+
+    template <typename... Args>
+    static void log(int formatId, const Args &...args)
+    {
+        char buf[kMaxArgBytes];
+        size_t len = 0;
+        encode(buf, &len, args...);
+        write(formatId, buf, len);
+    }
+
+    /**
+     * @brief 参数类型的签名，只在decltype中使用
+     */
+    template <typename... Args>
+    struct Signature
+    {
+        static const char *str()
+        {
+            static const char sig[] = {ArgTraits<typename std::decay<Args>::type>::code..., '\0'};
+            return sig;
+        }
+    };
+
+    template <typename... Args>
+    static Signature<Args...> signatureOf(const Args &...);
+
+    // 只用于编译期检查格式串，从不调用
+    static void checkFormat(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+private:
+    static void write(int formatId, const char *args, size_t len);
+
+    template <typename T, typename Enable = void>
+    struct ArgTraits
+    {
+        static_assert(sizeof(T) == 0, "unsupported argument type for binary logging");
+    };
+
+    static void encode(char *, size_t *) {}
+
+    template <typename T, typename... Rest>
+    static void encode(char *buf, size_t *len, const T &value, const Rest &...rest)
+    {
+        ArgTraits<typename std::decay<T>::type>::encode(buf, len, value);
+        encode(buf, len, rest...);
+    }
+
+    static void encodeRaw(char *buf, size_t *len, const void *data, size_t n)
+    {
+        if (*len + n <= kMaxArgBytes)
+        {
+            memcpy(buf + *len, data, n);
+            *len += n;
+        }
+    }
+
+    // 长度(uint32)加内容，空间不够时截断
+    static void encodeString(char *buf, size_t *len, const char *str);
+
+    static std::atomic<int> s_numFormats_;
+};
+
+/*
+整数按printf实际收到的类型保存：比int窄的类型、bool、枚举提升为int，
+这样解码时可以按格式串的长度修饰符(%hhu、%hd、%x...)截断，结果与LOG_*相同
+*/
+template <typename T>
+struct BinaryLog::ArgTraits<T, typename std::enable_if<(std::is_integral<T>::value && std::is_signed<T>::value) ||
+                                                        std::is_same<T, bool>::value || std::is_enum<T>::value>::type>
+{
+    using Stored = typename std::conditional<sizeof(T) <= sizeof(int32_t), int32_t, int64_t>::type;
+    static const char code = sizeof(Stored) == sizeof(int32_t) ? kInt32 : kInt64;
+    static void encode(char *buf, size_t *len, T value)
+    {
+        Stored v = static_cast<Stored>(value);
+        encodeRaw(buf, len, &v, sizeof v);
+    }
+};
+
+// unsigned char和unsigned short提升为int，值不变，按有符号保存
+template <typename T>
+struct BinaryLog::ArgTraits<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value &&
+                                                        !std::is_same<T, bool>::value>::type>
+{
+    using Stored = typename std::conditional<
+        sizeof(T) < sizeof(int32_t), int32_t,
+        typename std::conditional<sizeof(T) == sizeof(uint32_t), uint32_t, uint64_t>::type>::type;
+    static const char code = std::is_same<Stored, int32_t>::value    ? kInt32
+                             : std::is_same<Stored, uint32_t>::value ? kUInt32
+                                                                     : kUInt64;
+    static void encode(char *buf, size_t *len, T value)
+    {
+        Stored v = static_cast<Stored>(value);
+        encodeRaw(buf, len, &v, sizeof v);
+    }
+};
+
+template <typename T>
+struct BinaryLog::ArgTraits<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    static const char code = kDouble;
+    static void encode(char *buf, size_t *len, T value)
+    {
+        double v = static_cast<double>(value);
+        encodeRaw(buf, len, &v, sizeof v);
+    }
+};
+
+template <>
+struct BinaryLog::ArgTraits<const char *>
+{
+    static const char code = kString;
+    static void encode(char *buf, size_t *len, const char *value)
+    {
+        encodeString(buf, len, value ? value : "(null)");
+    }
+};
+
+template <>
+struct BinaryLog::ArgTraits<char *> : BinaryLog::ArgTraits<const char *>
+{
+};
+
+// 其它指针只保存地址，对应%p
+template <typename T>
+struct BinaryLog::ArgTraits<T *, typename std::enable_if<!std::is_same<typename std::remove_cv<T>::type, char>::value>::type>
+{
+    static const char code = kPointer;
+    static void encode(char *buf, size_t *len, const T *value)
+    {
+        uint64_t v = reinterpret_cast<uintptr_t>(value);
+        encodeRaw(buf, len, &v, sizeof v);
+    }
+};
@@ -85,6 +85,16 @@ std::string Buffer::retrieveAllAsString(size_t len)
     return result;
 }
 
+/**
+ * @brief 与rhs交换内容，不拷贝数据
+ */
+void Buffer::swap(Buffer &rhs)
+{
+    buffer_.swap(rhs.buffer_);
+    std::swap(readerIndex_, rhs.readerIndex_);
+    std::swap(writerIndex_, rhs.writerIndex_);
+}
+
 /**
  * @brief 确保缓冲区中有足够的空间
  */
@@ -47,6 +47,8 @@ public:
 
     std::string retrieveAllAsString(size_t len);
 
+    void swap(Buffer &rhs);
+
     void ensureWritableBytes(size_t len);
 
     void append(const char *data, size_t len);
@@ -2,8 +2,10 @@
 
 #include <memory>
 #include <functional>
+#include <sys/types.h>
 
 class Buffer;
+class EventLoop;
 class TcpConnection;
 class Timestamp;
 
@@ -18,6 +20,13 @@ using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr &, size_
 
 //
 using TimerCallback = std::function<void()>; // 定时器回调函数
+using SignalCallback = std::function<void(int signo)>; // 信号回调函数
+
+// io_uring完成模式下Poller执行完accept/recv后交付结果的回调
+using AcceptCompletionCallback = std::function<void(int connfd, int savedErrno)>; // connfd<0时savedErrno为错误码
+using CompletionBatchEndCallback = std::function<void()>;                         // 本轮的结果已经全部交付
+using RecvCompletionCallback = std::function<void(const char *data, ssize_t n, int savedErrno, Timestamp receiveTime)>;
+using SendCompletionCallback = std::function<void(ssize_t n, int savedErrno)>;                 // n<0时savedErrno为错误码
 
 //
 using ConnectionCallback = std::function<void(const TcpConnectionPtr &)>;    // 连接回调函数
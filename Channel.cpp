@@ -94,29 +94,43 @@ void Channel::update()
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
     LOG_INFO("channel handleEvent revents:%d\n", revents_);
+    LoopHeartbeat &heartbeat = loop_->heartbeat();
     if ((revents_ & EPOLLHUP) && !(revents_ & EPOLLIN)) // 客户端连接断开、closeCallBack_会将channel从poller中删除
     {
         if (closeCallBack_)
+        {
+            heartbeat.beginHandler(LoopHeartbeat::kClose, fd_, name_);
             closeCallBack_();
+        }
     }
 
     if ((revents_ & EPOLLERR)) // 错误
     {
         if (errorCallBack_)
+        {
+            heartbeat.beginHandler(LoopHeartbeat::kError, fd_, name_);
             errorCallBack_();
+        }
     }
 
     if (revents_ & (EPOLLIN | EPOLLPRI)) // 读事件
     {
         if (readCallBack_)
+        {
+            heartbeat.beginHandler(LoopHeartbeat::kRead, fd_, name_);
             readCallBack_(receiveTime);
+        }
     }
 
     if ((revents_ & EPOLLOUT)) // 写事件
     {
         if (writeCallBack_)
+        {
+            heartbeat.beginHandler(LoopHeartbeat::kWrite, fd_, name_);
             writeCallBack_();
+        }
     }
+    heartbeat.endHandler();
 }
 
 /**
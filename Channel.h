@@ -3,6 +3,7 @@
 #include <functional>
 #include "Timestamp.h"
 #include <memory>
+#include <string>
 
 class EventLoop;
 
@@ -49,6 +50,12 @@ public:
      */
     void tie(const std::shared_ptr<void> &obj);
 
+    /**
+     * @brief channel的名字、用于LoopWatchdog上报卡顿的归属。TcpConnection的channel即连接名
+     */
+    void setName(const std::string &name) { name_ = name; }
+    const std::string &name() const { return name_; }
+
     int fd();
     int events();
     void setRevents(int revents);
@@ -83,6 +90,7 @@ private:
     int events_;      // 注册fd感兴趣的事件
     int revents_;     // poller返回的具体发生的事件
     int index_;       // 用于标识channel在poller中的状态,取值为kNew、kAdded、kDeleted
+    std::string name_; // channel名字
 
     // weak_ptr实现观察者模式
     std::weak_ptr<void> tie_; // 用于解决channel的生命周期问题
@@ -2,12 +2,14 @@
 #include "Channel.h"
 #include "EventLoop.h"
 #include "Logger.h"
+#include "LogLimiter.h"
 #include "Socket.h"
 
 #include <cstring> // Include the <cstring> header file
 #include <unistd.h>
 
-// const int Connector::kMaxRetryDelayMs;
+// std::min按引用传参，需要定义
+const int Connector::KMaxRetryDelayMs;
 Connector::Connector(EventLoop *loop, const InetAddr &serverAddr)
     : loop_(loop),
       serverAddr_(serverAddr),
@@ -29,6 +31,17 @@ void Connector::start()
     loop_->runInLoop(std::bind(&Connector::startInLoop, this)); //
 }
 
+/**
+ * @brief 重置重连间隔并重新连接，TcpClient断线重连时调用
+ */
+void Connector::restart()
+{
+    setState(KDisconnected);
+    retryDelayMs_ = KInitRetryDelayMs;
+    connect_ = true;
+    startInLoop();
+}
+
 void Connector::stop()
 {
     connect_ = false;
@@ -97,6 +110,7 @@ void Connector::connecting(int sockfd)
     // 为什么使用reset，而不是直接赋值？
     // 因为channel_是一个unique_ptr，不能直接赋值。并且Connector是复用的，所以需要reset（具体看陈硕的LInux多线程服务端编程8.9）
     channel_.reset(new Channel(loop_, sockfd));
+    channel_->setName("Connector:" + serverAddr_.toIpPort());
     channel_->setWriteCallBack(std::bind(&Connector::handleWrite, this)); // 设置写事件回调函数
     channel_->setErrorCallBack(std::bind(&Connector::handleError, this)); // 设置错误事件回调函数
     channel_->enableWriting();                                            // 开启写事件监听
@@ -116,7 +130,8 @@ void Connector::retry(int sockfd)
     setState(KDisconnected);
     if (connect_)
     {
-        LOG_INFO("Connector::retry - Retry connecting to %s in %d milliseconds. \n", serverAddr_.toIpPort().c_str(), retryDelayMs_);
+        // 后端宕机时大量Connector同时重试，限速
+        LOG_INFO_RATELIMIT(10, "Connector::retry - Retry connecting to %s in %d milliseconds. \n", serverAddr_.toIpPort().c_str(), retryDelayMs_);
         // retryDelayMs_ / 1000.0 毫秒转换为秒
         loop_->runAfter(retryDelayMs_ / 1000.0, std::bind(&Connector::startInLoop, shared_from_this())); // 在retryDelayMs_/1000 时间后重连
         retryDelayMs_ = std::min(retryDelayMs_ * 2, Connector::KMaxRetryDelayMs);                        // 重连时间翻倍
@@ -182,12 +197,12 @@ void Connector::handleWrite()
 
 void Connector::handleError()
 {
-    LOG_ERROR("Connector::handleError state:%d \n", state_);
+    LOG_ERROR_RATELIMIT(10, "Connector::handleError state:%d \n", state_);
     if (state_ == KConnecting)
     {
         int sockfd = removeAndResetChannel();
         int err = Socket::getSocketError(sockfd);
-        LOG_ERROR("SO_ERROR:%d \n", err);
+        LOG_ERROR_RATELIMIT(10, "SO_ERROR:%d \n", err);
         retry(sockfd);
     }
 }
@@ -1,20 +1,32 @@
-
 #include "Poller.h"
 #include "EpollPoller.h"
+#include "PollPoller.h"
+#include "IoUringPoller.h"
+#include "Logger.h"
 
 #include <stdlib.h>
 
 /**
- * @brief eventloop可以通过该接口获取默认的IO复用的具体实现,默认使用EpollPoller
+ * @brief eventloop可以通过该接口获取默认的IO复用的具体实现,默认使用EpollPoller。
+ * 设置环境变量MUDUO_USE_POLL后使用PollPoller，设置MUDUO_USE_IO_URING后使用IoUringPoller，
+ * 设置MUDUO_IO_URING_COMPLETION后使用IoUringPoller的完成模式(由io_uring代为accept/recv/send)，
+ * 内核不支持io_uring时回退到EpollPoller。
+ * 环境变量统一使用MUDUO_前缀，早期拼错的MUDOU_USE_POLL仍然有效
  */
 Poller *Poller::newDefaultPolle(EventLoop *loop)
 {
-    if (::getenv("MUDOU_USE_POLL"))
+    if (::getenv("MUDUO_USE_POLL") || ::getenv("MUDOU_USE_POLL"))
     {
-        return nullptr; // 生成pollpoller的实例
+        return new PollPoller(loop); // 生成pollpoller的实例
     }
-    else
+    else if (::getenv("MUDUO_USE_IO_URING") || ::getenv("MUDUO_IO_URING_COMPLETION"))
     {
-        return new EpollPoller(loop); // 生成epoll的实例
+        Poller *poller = IoUringPoller::create(loop, ::getenv("MUDUO_IO_URING_COMPLETION") != nullptr);
+        if (poller != nullptr)
+        {
+            return poller;
+        }
+        LOG_INFO("io_uring is not available, fall back to epoll \n");
     }
+    return new EpollPoller(loop); // 生成epoll的实例
 }
@@ -0,0 +1,18 @@
+#include "TimerQueue.h"
+#include "SetTimerQueue.h"
+#include "WheelTimerQueue.h"
+
+#include <stdlib.h>
+
+/**
+ * @brief EventLoop通过该接口获取定时器队列的具体实现，默认使用SetTimerQueue。
+ * 设置环境变量MUDUO_USE_TIMER_WHEEL后使用WheelTimerQueue
+ */
+TimerQueue *TimerQueue::newDefaultTimerQueue(EventLoop *loop, bool useTimerfd)
+{
+    if (::getenv("MUDUO_USE_TIMER_WHEEL"))
+    {
+        return new WheelTimerQueue(loop, useTimerfd);
+    }
+    return new SetTimerQueue(loop, useTimerfd);
+}
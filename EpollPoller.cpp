@@ -2,9 +2,13 @@
 #include "EpollPoller.h"
 #include "Logger.h"
 #include "Channel.h"
+#include "FlightRecorder.h"
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <algorithm>
+#include <cassert>
+#include <sys/syscall.h>
 
 // channel未添加到poller中
 const int kNew = -1; // channel的成员index_=-1
@@ -12,11 +16,20 @@ const int kNew = -1; // channel的成员index_=-1
 const int KAdded = 1;
 // 从channel中删除poller
 const int kDeleted = 2;
+// fd不在内核的epoll中
+const int kNotRegistered = -1;
+
+std::atomic<int64_t> EpollPoller::numEpollCtls_(0);
+std::atomic<int64_t> EpollPoller::numSkippedCtls_(0);
 
 EpollPoller::EpollPoller(EventLoop *loop)
     : Poller(loop),
       epollfd_(epoll_create1(EPOLL_CLOEXEC)),
-      events_(kInitEventListSize)
+      events_(kInitEventListSize),
+      hasPwait2_(true),
+      numReady_(0),
+      avgReady_(0),
+      lowPolls_(0)
 {
     if (epollfd_ < 0)
     {
@@ -33,17 +46,16 @@ EpollPoller::~EpollPoller()
  * @brief 管理的fd对应的事件、上树、修改、删除
  * @param operation EPOLL_CTL_ADD, EPOLL_CTL_MOD, EPOLL_CTL_DEL
  */
-void EpollPoller::update(int operation, Channel *channel)
+void EpollPoller::update(int operation, int fd, int events, Channel *channel)
 {
     epoll_event event;
     bzero(&event, sizeof event);
 
-    int fd = channel->fd();
-
-    event.events = channel->events();
+    event.events = events;
     event.data.fd = fd;
     event.data.ptr = channel;
 
+    numEpollCtls_.fetch_add(1, std::memory_order_relaxed);
     if (::epoll_ctl(epollfd_, operation, fd, &event) < 0)
     {
         if (operation == EPOLL_CTL_DEL)
@@ -56,13 +68,82 @@ void EpollPoller::update(int operation, Channel *channel)
         }
     }
 }
+
 /**
- * @brief 触发事件时、填写活跃的连接
+ * @brief 记录fd的兴趣变化，同一个fd在一轮中只记录一次
  */
-void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
+void EpollPoller::markChanged(int fd)
 {
+    if (static_cast<size_t>(fd) >= interests_.size())
+    {
+        Interest init = {kNotRegistered, false};
+        interests_.resize(std::max(static_cast<size_t>(fd) + 1, interests_.size() * 2), init);
+    }
+    if (!interests_[fd].pending)
+    {
+        interests_[fd].pending = true;
+        changes_.push_back(fd);
+    }
+}
+
+/**
+ * @brief 期望的状态由fd当前对应的channel决定：index为KAdded时登记channel的events，否则不在epoll中
+ */
+void EpollPoller::applyChange(int fd)
+{
+    Interest &interest = interests_[fd];
+    interest.pending = false;
+
+    Channel *channel = findChannel(fd);
+    int wanted = (channel != nullptr && channel->index() == KAdded) ? channel->events() : kNotRegistered;
+    if (wanted == interest.registered)
+    {
+        numSkippedCtls_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    if (interest.registered == kNotRegistered)
+    {
+        update(EPOLL_CTL_ADD, fd, wanted, channel);
+    }
+    else if (wanted == kNotRegistered)
+    {
+        update(EPOLL_CTL_DEL, fd, 0, nullptr);
+    }
+    else
+    {
+        update(EPOLL_CTL_MOD, fd, wanted, channel);
+    }
+    interest.registered = wanted;
+}
+
+void EpollPoller::applyChanges()
+{
+    for (int fd : changes_)
+    {
+        if (interests_[fd].pending)
+        {
+            applyChange(fd);
+        }
+    }
+    changes_.clear();
+}
+
+/**
+ * @brief 直接从epoll_event数组分发事件，不再经过activeChannels
+ */
+void EpollPoller::dispatchEvents(Timestamp receiveTime, ChannelList *)
+{
+    const int numEvents = numReady_;
+    numReady_ = 0;
+    FlightRecorder::record(FlightRecorder::kPoll, -1, numEvents);
     for (int i = 0; i < numEvents; i++)
     {
+        // channel对象散落在堆上，处理当前channel时预取下一个
+        if (i + 1 < numEvents)
+        {
+            __builtin_prefetch(events_[i + 1].data.ptr);
+        }
         Channel *chan = static_cast<Channel *>(events_[i].data.ptr);
         if (chan == nullptr)
         {
@@ -71,8 +152,37 @@ void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
         }
 
         chan->setRevents(events_[i].events); // 设置为发生的事件
-        // eventLoop就拿到了它的poller给他返回的所有发生事件的channels列表
-        activeChannels->push_back(chan);
+        chan->handleEvent(receiveTime);
+    }
+    adjustEventListSize(numEvents);
+}
+
+/**
+ * @brief 事件数组被填满时加倍；就绪数的移动平均(权重1/8)连续kShrinkAfterPolls次不到长度的1/4时减半，
+ * 最短kInitEventListSize。加倍时把移动平均抬到新的长度，否则滞后的平均值会让刚扩大的数组马上又被收缩。
+ * 在分发之后调整，分发过程中events_保持不变
+ */
+void EpollPoller::adjustEventListSize(int numEvents)
+{
+    avgReady_ += (numEvents - avgReady_) / 8;
+    const size_t size = events_.size();
+    if (static_cast<size_t>(numEvents) == size)
+    {
+        events_.resize(size * 2);
+        avgReady_ = static_cast<double>(size * 2);
+        lowPolls_ = 0;
+    }
+    else if (size > kInitEventListSize && avgReady_ * 4 < size)
+    {
+        if (++lowPolls_ >= kShrinkAfterPolls)
+        {
+            EventList(events_.begin(), events_.begin() + size / 2).swap(events_);
+            lowPolls_ = 0;
+        }
+    }
+    else
+    {
+        lowPolls_ = 0;
     }
 }
 
@@ -80,28 +190,61 @@ void EpollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels)
  * @brief 开启事件循环，等待事件发生
 
 */
-Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
+Timestamp EpollPoller::poll(int timeoutMs, ChannelList *)
 {
     // 实际上应该用LOG_DEBUG输出日志更为合理
-    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, Channels_.size());
+    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, numChannels());
+    applyChanges();
 
     // 在这会阻塞，直到有事件发生
     int readyNumEvent = epoll_wait(epollfd_, &(*events_.begin()), static_cast<int>(events_.size()), timeoutMs);
 
     // 在这里触发事件了
-    int saveErrno = errno;
+    return handlePollResult(readyNumEvent, errno);
+}
+
+/**
+ * @brief 微秒精度的poll。内核支持时使用epoll_pwait2(timespec超时)，否则退化为毫秒精度的epoll_wait
+ */
+Timestamp EpollPoller::pollPrecise(int64_t timeoutUs, ChannelList *activeChannels)
+{
+#ifdef SYS_epoll_pwait2
+    if (hasPwait2_)
+    {
+        applyChanges();
+        struct timespec ts;
+        struct timespec *timeout = nullptr; // nullptr表示一直阻塞
+        if (timeoutUs >= 0)
+        {
+            ts.tv_sec = static_cast<time_t>(timeoutUs / Timestamp::kMicroSecondsPerSecond);
+            ts.tv_nsec = static_cast<long>((timeoutUs % Timestamp::kMicroSecondsPerSecond) * 1000);
+            timeout = &ts;
+        }
+        // 直接使用系统调用，避免依赖glibc 2.35才提供的包装函数
+        int readyNumEvent = static_cast<int>(::syscall(SYS_epoll_pwait2, epollfd_, &(*events_.begin()),
+                                                       static_cast<int>(events_.size()), timeout, nullptr, 0));
+        if (readyNumEvent >= 0 || errno != ENOSYS)
+        {
+            return handlePollResult(readyNumEvent, errno);
+        }
+        hasPwait2_ = false;
+        LOG_INFO("epoll_pwait2 is not supported, fall back to epoll_wait \n");
+    }
+#endif
+    return Poller::pollPrecise(timeoutUs, activeChannels);
+}
+
+/**
+ * @brief 处理epoll返回的结果，返回事件发生的时间
+ */
+Timestamp EpollPoller::handlePollResult(int readyNumEvent, int saveErrno)
+{
     Timestamp now(Timestamp::now());
     if (readyNumEvent > 0) // 有事件发生
     {
         LOG_INFO("%d events happend \n", readyNumEvent);
-        // 填充活跃的连接
-        fillActiveChannels(readyNumEvent, activeChannels);
-
-        // 发生事件的个数大于channels的最大长度--扩容
-        if (readyNumEvent == events_.size())
-        {
-            events_.resize(events_.size() * 2);
-        }
+        // 事件留在events_中，由dispatchEvents分发
+        numReady_ = readyNumEvent;
     }
     else if (readyNumEvent == 0) // 超时
     {
@@ -121,7 +264,7 @@ Timestamp EpollPoller::poll(int timeoutMs, ChannelList *activeChannels)
 }
 
 /**
- * @brief 更新channel管理的fd对应的事件
+ * @brief 更新channel管理的fd对应的事件，epoll_ctl推迟到下一次epoll_wait之前
  */
 void EpollPoller::updateChannel(Channel *channel)
 {
@@ -132,22 +275,19 @@ void EpollPoller::updateChannel(Channel *channel)
     {
         if (index == kNew)
         {
-            int fd = channel->fd();
-            Channels_[fd] = channel;
+            insertChannel(channel);
         }
         channel->setIndex(KAdded);
-        update(EPOLL_CTL_ADD, channel);
     } // channel已经在POLLER注册过
     else
     {
+        assert(findChannel(channel->fd()) == channel);
         if (channel->isNoneEvent())
         {
-            update(EPOLL_CTL_DEL, channel);
             channel->setIndex(kDeleted);
         }
-        else
-            update(EPOLL_CTL_MOD, channel);
     }
+    markChanged(channel->fd());
 }
 
 /**
@@ -156,13 +296,13 @@ void EpollPoller::updateChannel(Channel *channel)
 void EpollPoller::removeChannle(Channel *channel)
 {
     const int fd = channel->fd();
-    int index = channel->index();
-    Channels_.erase(fd);
+    eraseChannel(channel);
     LOG_INFO("func=%s fd=%d ", __FUNCTION__, fd);
 
-    if (index == KAdded)
+    channel->setIndex(kNew); // channel置空
+    // 调用者随后可能关闭fd，立即从内核中删除
+    if (static_cast<size_t>(fd) < interests_.size())
     {
-        update(EPOLL_CTL_DEL, channel);
+        applyChange(fd);
     }
-    channel->setIndex(kNew); // channel置空
 }
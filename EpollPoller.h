@@ -2,11 +2,18 @@
 #include "Poller.h"
 #include "Timestamp.h"
 #include <vector>
+#include <atomic>
+#include <stdint.h>
 #include <sys/epoll.h>
 class Channel;
 
 /**
  * @brief EpollPoller继承自Poller、封装的是Epoll的使用。
+ * updateChannel不会立即调用epoll_ctl，而是按fd记录下来，在下一次epoll_wait之前与内核中的状态比较后统一提交，
+ * 同一轮中相互抵消的修改(如先enableWriting再disableWriting)不产生系统调用。
+ * removeChannle之后fd可能马上被关闭，所以删除仍然立即提交。
+ * 就绪事件不经过ChannelList，由dispatchEvents直接从epoll_event数组分发；
+ * 事件数组按就绪数的移动平均扩容和收缩。
  */
 class EpollPoller : public Poller
 {
@@ -15,21 +22,68 @@ public:
     EpollPoller(EventLoop *loop);
     ~EpollPoller() override;
     Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    Timestamp pollPrecise(int64_t timeoutUs, ChannelList *activeChannels) override;
     void updateChannel(Channel *channel) override;
     void removeChannle(Channel *channel) override;
+    void dispatchEvents(Timestamp receiveTime, ChannelList *activeChannels) override;
+
+    /**
+     * @brief 进程内所有EpollPoller累计调用epoll_ctl的次数
+     */
+    static int64_t numEpollCtls() { return numEpollCtls_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 进程内所有EpollPoller因为合并而省掉的epoll_ctl次数
+     */
+    static int64_t numSkippedCtls() { return numSkippedCtls_.load(std::memory_order_relaxed); }
 
 private:
     using EventList = std::vector<epoll_event>;
+
+    /**
+     * @brief fd在内核epoll中的状态，按fd下标存放
+     */
+    struct Interest
+    {
+        int registered; // 内核中登记的事件，kNotRegistered表示不在epoll中
+        bool pending;   // 是否已经在changes_中等待提交
+    };
+
     static const int kInitEventListSize = 16;
+    // 就绪数的移动平均连续这么多次poll都不到事件数组长度的1/4才收缩
+    static const int kShrinkAfterPolls = 64;
     // epoll句柄
     int epollfd_;
     // epoll的事件数组
     EventList events_;
+    // 内核是否支持epoll_pwait2(纳秒精度超时)，第一次返回ENOSYS后置为false
+    bool hasPwait2_;
+    // 上一次poll就绪的事件数，等待dispatchEvents分发
+    int numReady_;
+    // 就绪事件数的指数移动平均，用来决定是否收缩事件数组
+    double avgReady_;
+    // 移动平均连续低于事件数组长度1/4的poll次数
+    int lowPolls_;
+    // 按fd记录的内核状态
+    std::vector<Interest> interests_;
+    // 等待在下一次epoll_wait之前提交的fd
+    std::vector<int> changes_;
+
+    static std::atomic<int64_t> numEpollCtls_;
+    static std::atomic<int64_t> numSkippedCtls_;
     // 初始化事件数组的长度
 
 private:
-    // 填写活跃连接
-    void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
-    // 更新channel
-    void update(int operation, Channel *channel);
+    // 处理epoll_wait/epoll_pwait2的返回值
+    Timestamp handlePollResult(int readyNumEvent, int saveErrno);
+    // 根据本轮就绪数调整事件数组的长度
+    void adjustEventListSize(int numEvents);
+    // 记录fd的兴趣变化
+    void markChanged(int fd);
+    // 把fd期望的状态与内核中的状态比较，必要时调用epoll_ctl
+    void applyChange(int fd);
+    // 提交所有记录下来的兴趣变化
+    void applyChanges();
+    // 调用epoll_ctl
+    void update(int operation, int fd, int events, Channel *channel);
 };
@@ -3,11 +3,17 @@
 #include "Poller.h"
 #include "Channel.h"
 #include "TimerQueue.h"
+#include "LoopWatchdog.h"
+#include "SignalHandler.h"
+#include "FlightRecorder.h"
+#include "LogLimiter.h"
 #include <signal.h>
+#include <stdlib.h>
 #include <sys/eventfd.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <memory>
+#include <algorithm>
 #include <error.h>
 
 //// 防止一个线程创建多个EventLoop   thread_local
@@ -17,6 +23,17 @@ __thread EventLoop *t_loopInthisThread = nullptr;
 
 // 定义默认的Poller IO复用接口的超时时间
 const int KPollTimeMs = 10000;
+// 每次迭代默认最多执行的低优先级回调数量
+const size_t kMaxLowPriorityFunctors = 16;
+
+/**
+ * @brief 是否使用timerfd通知定时器到期。设置环境变量MUDUO_NO_TIMERFD后，
+ * 定时器的到期时间直接作为poll的超时时间，poll返回后在loop中执行到期的定时器
+ */
+static bool useTimerfd()
+{
+    return ::getenv("MUDUO_NO_TIMERFD") == nullptr;
+}
 
 int createEventfd()
 {
@@ -43,10 +60,15 @@ IgnoreSigPipe initObj; // 全局对象、初始化时、忽略SIGPIPE信号
 EventLoop::EventLoop() : looping_(false),
                          quit_(false), callingPendingFunctors_(false),
                          threadId_(CurrentThread::tid()),
+                         heartbeat_(threadId_),
+                         watchdog_(nullptr),
                          poller_(Poller::newDefaultPolle(this)),
                          wakeupfd_(createEventfd()),
                          wakeupChannel_(new Channel(this, wakeupfd_)),
-                         timerQueue_(new TimerQueue(this))
+                         maxLowPriorityFunctors_(kMaxLowPriorityFunctors),
+                         lowFunctorsLeft_(false),
+                         suppressionFlushScheduled_(false),
+                         timerQueue_(TimerQueue::newDefaultTimerQueue(this, useTimerfd()))
 
 {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
@@ -64,11 +86,13 @@ EventLoop::EventLoop() : looping_(false),
     // 设置wakeupfd的事件类型以及发生事件后的回调操作
     wakeupChannel_->setReadCallBack(std::bind(&EventLoop::handleRead, this));
     // 每一个eventloop都将监听wakeupchannel的EPOLLIN读事件了
+    wakeupChannel_->setName("wakeup");
     wakeupChannel_->enableReading();
 }
 
 EventLoop::~EventLoop()
 {
+    LoopWatchdog::detach(this);
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupfd_);
@@ -87,26 +111,84 @@ void EventLoop::loop()
 
     while (!quit_)
     {
+        heartbeat_.beginIteration();
         activeChannels_.clear();
         // 监听两类fd   一种是client的fd，一种wakeupfd。
-        // 在这里会阻塞、调用了epoll_wait
-        pollReturnTime_ = poller_->poll(KPollTimeMs, &activeChannels_);
+        // 在这里会阻塞、调用了epoll_wait。还有没执行完的低优先级回调时不阻塞
+        if (timerQueue_->usesTimerfd())
+        {
+            pollReturnTime_ = poller_->poll(lowFunctorsLeft_ ? 0 : KPollTimeMs, &activeChannels_);
+        }
+        else
+        {
+            pollReturnTime_ = poller_->pollPrecise(pollTimeoutUs(), &activeChannels_);
+        }
+
+        pollReturnMonotonic_ = MonotonicTime::now();
+        FlightRecorder::setTime(pollReturnMonotonic_.microSeconds()); // 之后记录的事件都用这次poll返回的时间
+
+        // 到这里，poller就已经返回了，说明有事件发生了，由poller通知channel处理相应的事件
+        poller_->dispatchEvents(pollReturnTime_, &activeChannels_);
 
-        // 到这里，poller就已经返回了，说明有事件发生了
-        for (Channel *channel : activeChannels_)
+        // 不使用timerfd时，在这里执行到期的定时器
+        if (!timerQueue_->usesTimerfd())
         {
-            // Poller监听哪些channel发生事件了，然后上报给EventLoop，通知channel处理相应的事件
-            channel->handleEvent(pollReturnTime_);
+            timerQueue_->processExpired(pollReturnMonotonic_);
         }
 
         // Poller中事件发生后、执行当前EventLoop事件循环需要处理的回调操作
         doPendingFunctors();
+
+        // 本线程有被限流的日志还没报告时，安排定时器补报，调用处之后不再输出日志也能看到计数
+        if (!suppressionFlushScheduled_ && LogSuppression::hasPending())
+        {
+            scheduleSuppressionFlush();
+        }
     }
 
     LOG_INFO("EventLoop %p stop looping \n", this);
     looping_ = false;
 }
 
+/**
+ * @brief 不使用timerfd时poll的超时时间：距离最早到期定时器的时间，最长KPollTimeMs。
+ * 先与缓存的poll返回时间比较，定时器已经到期或没有定时器时不读时钟；
+ * 否则要扣掉本轮回调已经用掉的时间，读一次单调时钟，只用缓存的时间会让定时器晚到这么久
+ */
+int64_t EventLoop::pollTimeoutUs() const
+{
+    int64_t timeoutUs = static_cast<int64_t>(KPollTimeMs) * 1000;
+    if (lowFunctorsLeft_)
+    {
+        return 0;
+    }
+    MonotonicTime next = timerQueue_->nextExpiration();
+    if (next.valid())
+    {
+        if (!(pollReturnMonotonic_ < next))
+        {
+            return 0;
+        }
+        int64_t untilNext = next.microSeconds() - MonotonicTime::now().microSeconds();
+        timeoutUs = std::max<int64_t>(0, std::min(timeoutUs, untilNext));
+    }
+    return timeoutUs;
+}
+
+/**
+ * @brief 到时间后报告本线程被限流的日志计数，还有没到时间的调用处时下一轮迭代会重新安排
+ */
+void EventLoop::scheduleSuppressionFlush()
+{
+    suppressionFlushScheduled_ = true;
+    runAfter(LogSuppression::kSummaryIntervalMs / 1000.0, [this]()
+             {
+                 suppressionFlushScheduled_ = false;
+                 LogSuppression::flushPending();
+             },
+             0.1);
+}
+
 /**
  * @brief 退出事件循环。有两种被调用的情况
  * 1.loop在自己的线程中调用quit  2.在非loop的线程中，调用loop的quit
@@ -132,34 +214,52 @@ Timestamp EventLoop::pollReturnTime() const
     return pollReturnTime_;
 }
 
+const char *EventLoop::httpDate()
+{
+    // 第一次poll返回之前没有缓存的时间
+    return dateCache_.format(pollReturnTime_.valid() ? pollReturnTime_ : Timestamp::now());
+}
+
 /**
  * @brief 在当前的loop中执行cb
+ * @param priority 回调的优先级。kLowPriority的回调总是入队、受每次迭代的数量限制
  */
-void EventLoop::runInLoop(Functor cb)
+void EventLoop::runInLoop(Functor cb, Priority priority)
 {
     // q:为什么要分开处理？
     // 保证一个fd只在一个线程中被处理
-    if (isInLoopThread()) // 在当前的loop线程中，执行cb
+    if (isInLoopThread() && priority != kLowPriority) // 在当前的loop线程中，执行cb
     {
         cb();
     }
     else // 当前loop所在线程和cb所在线程不是同一个线程，不应该在当前loop线程中执行cb
     {
         // 保存到队列中，唤醒loop所在线程，执行cb
-        queueInLoop(cb);
+        queueInLoop(std::move(cb), priority);
     }
 }
 
 /**
- * @brief 把cb放入队列中，唤醒loop所在的线程，执行cb
+ * @brief 把cb放入对应优先级的队列中，唤醒loop所在的线程，执行cb
  */
-void EventLoop::queueInLoop(Functor cb)
+void EventLoop::queueInLoop(Functor cb, Priority priority)
 {
     {
         // 为什么要加锁？？
         // 因为有可能在多个线程中调用queueInLoop()函数，向pendingFunctors_中添加回调函数
         std::unique_lock<std::mutex> lock(mutex_);
-        pendingFunctors_.emplace_back(cb);
+        switch (priority)
+        {
+        case kHighPriority:
+            highPendingFunctors_.emplace_back(std::move(cb));
+            break;
+        case kLowPriority:
+            lowPendingFunctors_.emplace_back(std::move(cb));
+            break;
+        default:
+            pendingFunctors_.emplace_back(std::move(cb));
+            break;
+        }
     }
     // 唤醒相应的，需要执行上面回调操作的loop的线程了
     // || callingPendingFunctors_的意思是：当前loop正在执行回调，但是loop又有了新的回调
@@ -211,6 +311,31 @@ bool EventLoop::hasChannel(Channel *channel)
     return poller_->hasChannel(channel);
 }
 
+bool EventLoop::startAccept(Channel *channel, AcceptCompletionCallback onAccept, CompletionBatchEndCallback onBatchEnd)
+{
+    return poller_->startAccept(channel, std::move(onAccept), std::move(onBatchEnd));
+}
+
+bool EventLoop::startRecv(Channel *channel, RecvCompletionCallback onRecv, CompletionBatchEndCallback onBatchEnd)
+{
+    return poller_->startRecv(channel, std::move(onRecv), std::move(onBatchEnd));
+}
+
+bool EventLoop::startSend(Channel *channel, SendCompletionCallback onSend)
+{
+    return poller_->startSend(channel, std::move(onSend));
+}
+
+void EventLoop::submitSend(Channel *channel, const char *data, size_t len, const std::shared_ptr<void> &owner)
+{
+    poller_->submitSend(channel, data, len, owner);
+}
+
+void EventLoop::stopCompletion(Channel *channel)
+{
+    poller_->stopCompletion(channel);
+}
+
 //
 /**
  * @brief 判断EventLoop对象是否在自己的线程里面
@@ -224,37 +349,81 @@ bool EventLoop::isInLoopThread() const
 }
 
 /**
- * @brief 在指定的时间执行回调函数
-
-*/
-TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+ * @brief 在指定的时间执行回调函数。time是墙上时间，添加时换算成单调时钟上的到期时间，
+ * 之后调整系统时间不影响这个定时器
+ */
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb, double slack)
 {
-    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+    double delay = timeDifference(time, Timestamp::now());
+    return timerQueue_->addTimer(std::move(cb), addTime(MonotonicTime::now(), delay), 0.0, slack);
 }
 
 /**
  * @brief 在指定的时间间隔后执行回调函数
  */
-TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+TimerId EventLoop::runAfter(double delay, TimerCallback cb, double slack)
+{
+    return timerQueue_->addTimer(std::move(cb), addTime(timerBase(), delay), 0.0, slack);
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb, double slack)
+{
+    return timerQueue_->addTimer(std::move(cb), addTime(timerBase(), interval), interval, slack);
+}
+
+/**
+ * @brief loop线程中使用本轮poll返回时的单调时间，不必每个定时器读一次时钟，
+ * 定时器相对调用时刻最多提前本轮回调已经用掉的时间；其它线程和第一次poll之前读时钟
+ */
+MonotonicTime EventLoop::timerBase() const
+{
+    if (isInLoopThread() && pollReturnMonotonic_.valid())
+    {
+        return pollReturnMonotonic_;
+    }
+    return MonotonicTime::now();
+}
+
+/**
+ * @brief 取消定时器。定时器已经到期或已经取消时什么也不做
+ */
+void EventLoop::cancel(TimerId timerId)
 {
-    Timestamp time(addTime(Timestamp::now(), delay));
-    return runAt(time, std::move(cb));
+    timerQueue_->cancel(timerId);
 }
 
-TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+/**
+ * @brief 注册信号回调。先在调用线程中阻塞该信号，之后创建的线程会继承信号掩码
+ */
+void EventLoop::onSignal(int signo, SignalCallback cb)
 {
-    Timestamp time(addTime(Timestamp::now(), interval));
-    return timerQueue_->addTimer(std::move(cb), time, interval);
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, signo);
+    ::pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+
+    runInLoop(std::bind(&EventLoop::addSignalInLoop, this, signo, std::move(cb)));
+}
+
+void EventLoop::addSignalInLoop(int signo, const SignalCallback &cb)
+{
+    if (!signalHandler_)
+    {
+        signalHandler_.reset(new SignalHandler(this));
+    }
+    signalHandler_->add(signo, cb);
 }
 
 /**
- * @brief 执行事件的回调函数。
+ * @brief 执行事件的回调函数。按高、普通、低的优先级顺序执行，低优先级每次最多执行maxLowPriorityFunctors_个
  */
 void EventLoop::doPendingFunctors() // 执行回调
 {
     // 为什么要用临时数组保存？
     // 在下面foreach执行过程中、有可能其它线程在往pendingFunctors_中插入回调函数。所以要加锁
+    std::vector<Functor> highFunctors;
     std::vector<Functor> functors;
+    std::vector<Functor> lowFunctors;
     // q:为什么要用一个临时变量来存储回调函数？
     // a:因为在执行回调函数的过程中，有可能会再次调用queueInLoop()函数，从而向pendingFunctors_中添加新的回调函数。
 
@@ -262,15 +431,34 @@ void EventLoop::doPendingFunctors() // 执行回调
 
     {
         std::unique_lock<std::mutex> lock(mutex_);
-        functors.swap(pendingFunctors_); // 将待处理的回调操作交换到临时容器中，并清空原始容器
+        highFunctors.swap(highPendingFunctors_); // 将待处理的回调操作交换到临时容器中，并清空原始容器
+        functors.swap(pendingFunctors_);
+        size_t n = std::min(maxLowPriorityFunctors_, lowPendingFunctors_.size());
+        lowFunctors.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            lowFunctors.emplace_back(std::move(lowPendingFunctors_.front()));
+            lowPendingFunctors_.pop_front();
+        }
+        lowFunctorsLeft_ = !lowPendingFunctors_.empty();
     }
 
+    runFunctors(highFunctors);
+    runFunctors(functors); // 执行当前loop需要执行的回调操作
+    runFunctors(lowFunctors);
+
+    callingPendingFunctors_ = false;
+}
+
+void EventLoop::runFunctors(const std::vector<Functor> &functors)
+{
+    static const std::string kFunctorName("pendingFunctor");
     for (const Functor &functor : functors)
     {
-        functor(); // 执行当前loop需要执行的回调操作
+        heartbeat_.beginHandler(LoopHeartbeat::kFunctor, -1, kFunctorName);
+        functor();
+        heartbeat_.endHandler();
     }
-
-    callingPendingFunctors_ = false;
 }
 
 /**
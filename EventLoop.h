@@ -2,6 +2,7 @@
 
 #include <functional>
 #include <vector>
+#include <deque>
 #include <atomic>
 #include <memory>
 #include <mutex>
@@ -12,9 +13,13 @@
 #include "TimerId.h"
 #include "TimerQueue.h"
 #include "Timer.h"
+#include "LoopHeartbeat.h"
+#include "TimestampFormatter.h"
 class Channel;
 class Poller;
 class TimerQueue;
+class LoopWatchdog;
+class SignalHandler;
 /**
  * @brief 事件循环类  主要包含了两个大模块 Channel   Poller（epoll的抽象）。EventLoop是Reactor模式的核心
  * 1. 启动或者退出事件循环
@@ -26,30 +31,76 @@ class EventLoop : noncopyable
 
 public:
     using Functor = std::function<void()>;
+
+    /**
+     * @brief 回调的优先级。每次迭代先执行全部高优先级回调，再执行全部普通回调，
+     * 最后最多执行maxLowPriorityFunctors个低优先级回调，避免后台任务饿死socket IO
+     */
+    enum Priority
+    {
+        kHighPriority,   // 连接建立等控制类任务。连接销毁用普通优先级，排在之前提交的send/shutdown之后，不丢数据
+        kNormalPriority, // 默认
+        kLowPriority,    // 统计、缓存刷新等后台任务
+    };
+
     EventLoop();
     ~EventLoop();
 
     void loop();
     void quit();
 
+    // 本轮poll返回时的墙上时间，每轮迭代在poll之后刷新一次
     Timestamp pollReturnTime() const;
-
-    // 在当前loop中执行cb
-    void runInLoop(Functor cb);
-    // 把cb放入队列中、唤醒loop所在的线程、执行回调
-    void queueInLoop(Functor cb);
+    // 本轮poll返回时的单调时间，热路径上测量耗时/判断超时时读取它，不必每次调用clock_gettime。
+    // 只能在loop线程中调用，精度受当前迭代中已经执行的回调耗时影响
+    MonotonicTime pollReturnMonotonic() const { return pollReturnMonotonic_; }
+    // 当前秒的RFC 7231日期(用于HTTP的Date头)，按poll返回时间每秒最多格式化一次、只能在loop线程中调用
+    const char *httpDate();
+
+    // 在当前loop中执行cb。低优先级的cb即使在loop线程中调用也会入队
+    void runInLoop(Functor cb, Priority priority = kNormalPriority);
+    // 把cb放入对应优先级的队列中、唤醒loop所在的线程、执行回调
+    void queueInLoop(Functor cb, Priority priority = kNormalPriority);
+    // 设置每次迭代最多执行的低优先级回调数量
+    void setMaxLowPriorityFunctors(size_t n) { maxLowPriorityFunctors_ = n; }
     void wakeup();
     void updateChannel(Channel *channel);
     void removeChannel(Channel *channel);
     bool hasChannel(Channel *channel);
+    // io_uring完成模式下由Poller代为accept/recv，Poller不支持时返回false，见Poller::startAccept
+    bool startAccept(Channel *channel, AcceptCompletionCallback onAccept, CompletionBatchEndCallback onBatchEnd);
+    bool startRecv(Channel *channel, RecvCompletionCallback onRecv, CompletionBatchEndCallback onBatchEnd);
+    bool startSend(Channel *channel, SendCompletionCallback onSend);
+    void submitSend(Channel *channel, const char *data, size_t len, const std::shared_ptr<void> &owner);
+    void stopCompletion(Channel *channel);
     bool isInLoopThread() const;
 
-    TimerId runAt(Timestamp time, TimerCallback cb);     // 在指定的时间执行回调函数
-    TimerId runAfter(double delay, TimerCallback cb);    // 在指定的时间间隔后执行回调函数
-    TimerId runEvery(double interval, TimerCallback cb); // 每隔一段时间执行回调函数
+    // slack为允许推迟执行的秒数，可以与其它定时器合并唤醒；小于0时使用setTimerSlack设置的默认值
+    TimerId runAt(Timestamp time, TimerCallback cb, double slack = -1.0);     // 在指定的时间执行回调函数
+    TimerId runAfter(double delay, TimerCallback cb, double slack = -1.0);    // 在指定的时间间隔后执行回调函数
+    TimerId runEvery(double interval, TimerCallback cb, double slack = -1.0); // 每隔一段时间执行回调函数
+    void cancel(TimerId timerId);                                             // 取消定时器、可以在任意线程调用
+    // 设置之后添加的定时器的默认slack(秒)，默认为0
+    void setTimerSlack(double seconds) { timerQueue_->setDefaultSlack(seconds); }
+    // 定时器唤醒、合并和timerfd_settime的统计
+    TimerQueue::Stats timerStats() const { return timerQueue_->stats(); }
+
+    // 通过signalfd在loop线程中处理信号signo、可以在任意线程调用。应在创建其它线程之前调用
+    void onSignal(int signo, SignalCallback cb);
+
+    // loop的心跳信息、供LoopWatchdog检测卡顿
+    LoopHeartbeat &heartbeat() { return heartbeat_; }
+    // 由LoopWatchdog持有registryMutex()时调用、loop析构时通过LoopWatchdog::detach自动从看门狗中移除
+    void setWatchdog(LoopWatchdog *watchdog) { watchdog_ = watchdog; }
+    LoopWatchdog *watchdog() const { return watchdog_.load(); }
 
 private:
     void doPendingFunctors();
+    void runFunctors(const std::vector<Functor> &functors);
+    void addSignalInLoop(int signo, const SignalCallback &cb);
+    int64_t pollTimeoutUs() const;
+    MonotonicTime timerBase() const; // runAfter/runEvery计算到期时间的起点
+    void scheduleSuppressionFlush(); // 安排定时器报告本线程被限流的日志计数
     void handleRead();
 
     using ChannelList = std::vector<Channel *>;
@@ -62,7 +113,12 @@ private:
 
     const pid_t threadId_; // 记录当前loop所在线程的ID
 
-    Timestamp pollReturnTime_; // poller返回事件的channels的时间戳
+    LoopHeartbeat heartbeat_;            // 心跳信息：迭代次数、当前回调的开始时间和归属
+    std::atomic<LoopWatchdog *> watchdog_; // 监视当前loop的看门狗、没有则为nullptr
+
+    Timestamp pollReturnTime_;         // poller返回事件的channels的时间戳
+    MonotonicTime pollReturnMonotonic_; // poller返回时的单调时间
+    HttpDateCache dateCache_;           // httpDate()的缓存
     std::unique_ptr<Poller> poller_;
 
     int wakeupfd_; // 主要作用，当mainLoop获取一个新用户的channel，通过轮询算法选择一个subloop，通过该成员唤醒subloop处理channel
@@ -70,8 +126,14 @@ private:
 
     // 一个EventLoop对象可以拥有多个Channel对象，每个Channel对象都属于一个EventLoop对象
     ChannelList activeChannels_;
-    std::vector<Functor> pendingFunctors_; // 存储loop需要执行的所有回调操作
-    std::mutex mutex_;                     // 互斥锁，用来保护上面vector容器的线程安全操作
+    std::vector<Functor> highPendingFunctors_; // 高优先级回调
+    std::vector<Functor> pendingFunctors_;     // 存储loop需要执行的普通回调操作
+    std::deque<Functor> lowPendingFunctors_;   // 低优先级回调、每次迭代只取出一部分执行
+    std::mutex mutex_;                         // 互斥锁，用来保护上面三个容器的线程安全操作
+    size_t maxLowPriorityFunctors_;            // 每次迭代最多执行的低优先级回调数量
+    bool lowFunctorsLeft_;                     // 上一次迭代后是否还有低优先级回调、有则poll不阻塞
+    bool suppressionFlushScheduled_;           // 是否已经安排了报告限流日志计数的定时器
 
     std::unique_ptr<TimerQueue> timerQueue_; // 定时器队列
+    std::unique_ptr<SignalHandler> signalHandler_; // 信号处理、第一次onSignal时创建
 };
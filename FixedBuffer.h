@@ -0,0 +1,42 @@
+#pragma once
+#include "noncopyable.h"
+
+#include <string.h>
+#include <stddef.h>
+
+const int kSmallBuffer = 4000; // 一条日志的缓冲区
+
+/**
+ * @brief 定长缓冲区，只追加不扩容，空间不够时丢弃整条数据
+ */
+template <int SIZE>
+class FixedBuffer : noncopyable
+{
+public:
+    FixedBuffer() : cur_(data_) {}
+
+    void append(const char *buf, size_t len)
+    {
+        if (static_cast<size_t>(avail()) > len)
+        {
+            memcpy(cur_, buf, len);
+            cur_ += len;
+        }
+    }
+
+    const char *data() const { return data_; }
+    int length() const { return static_cast<int>(cur_ - data_); }
+
+    char *current() { return cur_; }
+    int avail() const { return static_cast<int>(end() - cur_); }
+    void add(size_t len) { cur_ += len; }
+
+    void reset() { cur_ = data_; }
+    void bzero() { ::memset(data_, 0, sizeof data_); }
+
+private:
+    const char *end() const { return data_ + sizeof data_; }
+
+    char data_[SIZE];
+    char *cur_;
+};
@@ -0,0 +1,359 @@
+#include "FlightRecorder.h"
+#include "CurrentThread.h"
+#include "LogStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace
+{
+    struct Event
+    {
+        int64_t timeUs;
+        uint32_t type;
+        int32_t fd;
+        int64_t a;
+        int64_t b;
+    };
+    static_assert(sizeof(Event) == 32, "flight recorder event should stay 32 bytes");
+    static_assert((FlightRecorder::kEventsPerThread & (FlightRecorder::kEventsPerThread - 1)) == 0,
+                  "kEventsPerThread must be a power of two");
+
+    /**
+     * @brief 一个线程的环，紧跟着这个线程的备用信号栈，一起mmap出来，进程退出前不释放
+     */
+    struct Ring
+    {
+        std::atomic<int> owner;     // 所属线程的tid，0表示线程已经退出，可以给新线程使用
+        char name[16];              // 线程名
+        std::atomic<uint64_t> next; // 已经写入的事件数，只由所属线程增加
+        Event events[FlightRecorder::kEventsPerThread];
+    };
+
+    const size_t kAltStackSize = 64 * 1024; // 栈溢出导致的SIGSEGV要在备用栈上处理
+
+    std::atomic<Ring *> g_rings[FlightRecorder::kMaxThreads];
+    std::atomic<int> g_numRings(0);
+
+    thread_local Ring *t_ring = nullptr;
+    thread_local bool t_unavailable = false; // 关闭或者环已经用完，不再尝试
+    thread_local int64_t t_timeUs = 0;
+
+    /**
+     * @brief 线程退出时把环还回去给之后的线程复用，在被复用之前其中的事件仍然会被导出
+     */
+    struct RingReleaser
+    {
+        ~RingReleaser()
+        {
+            if (t_ring != nullptr)
+            {
+                t_ring->owner.store(0, std::memory_order_release);
+                t_ring = nullptr;
+            }
+        }
+    };
+    thread_local RingReleaser t_releaser;
+
+    const struct
+    {
+        const char *name;
+        const char *a; // nullptr表示不输出
+        const char *b;
+    } kEventNames[FlightRecorder::kNumEventTypes] = {
+        {"poll", "events", nullptr},
+        {"conn-up", "peer", nullptr},
+        {"conn-down", "state", nullptr},
+        {"read", "bytes", "errno"},
+        {"send", "bytes", "written"},
+        {"write", "written", "remaining"},
+        {"accept", "errno", nullptr},
+        {"error", "so_error", nullptr},
+        {"user", "a", "b"},
+    };
+
+    const int kFatalSignals[] = {SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT};
+
+    /**
+     * @brief 输出崩溃前的事件后恢复默认处理(SA_RESETHAND)，再发一次信号，进程照常退出并产生core
+     */
+    void crashHandler(int signo)
+    {
+        char line[64];
+        const char prefix[] = "FlightRecorder: caught fatal signal ";
+        size_t len = sizeof prefix - 1;
+        memcpy(line, prefix, len);
+        len += LogStream::convert(line + len, static_cast<long long>(signo));
+        line[len++] = '\n';
+        ssize_t n = ::write(STDERR_FILENO, line, len);
+        (void)n;
+        FlightRecorder::dump(STDERR_FILENO);
+        ::raise(signo);
+    }
+
+    void installCrashHandlers()
+    {
+        for (int signo : kFatalSignals)
+        {
+            struct sigaction old;
+            if (::sigaction(signo, nullptr, &old) == 0 && !(old.sa_flags & SA_SIGINFO) && old.sa_handler == SIG_DFL)
+            {
+                struct sigaction sa;
+                memset(&sa, 0, sizeof sa);
+                sa.sa_handler = crashHandler;
+                sigemptyset(&sa.sa_mask);
+                sa.sa_flags = SA_RESETHAND | SA_NODEFER | SA_ONSTACK;
+                ::sigaction(signo, &sa, nullptr);
+            }
+        }
+    }
+
+    // 当前线程还没有备用信号栈时使用ring后面的那一段
+    void setAltStack(Ring *ring)
+    {
+        stack_t old;
+        if (::sigaltstack(nullptr, &old) == 0 && (old.ss_flags & SS_DISABLE))
+        {
+            stack_t ss;
+            ss.ss_sp = reinterpret_cast<char *>(ring) + sizeof(Ring);
+            ss.ss_size = kAltStackSize;
+            ss.ss_flags = 0;
+            ::sigaltstack(&ss, nullptr);
+        }
+    }
+
+    /**
+     * @brief 先复用已经退出的线程留下的环，没有时mmap一个新的。超过kMaxThreads时返回nullptr
+     */
+    Ring *acquireRing()
+    {
+        const int tid = CurrentThread::tid();
+        const int numRings = std::min(g_numRings.load(std::memory_order_acquire), static_cast<int>(FlightRecorder::kMaxThreads));
+        for (int i = 0; i < numRings; ++i)
+        {
+            Ring *ring = g_rings[i].load(std::memory_order_acquire);
+            int expected = 0;
+            if (ring != nullptr && ring->owner.load(std::memory_order_relaxed) == 0 &&
+                ring->owner.compare_exchange_strong(expected, tid))
+            {
+                ring->next.store(0, std::memory_order_relaxed);
+                return ring;
+            }
+        }
+
+        const int index = g_numRings.fetch_add(1);
+        if (index >= FlightRecorder::kMaxThreads)
+        {
+            return nullptr;
+        }
+        // MAP_NORESERVE：没有写到的页不占用内存
+        void *mem = ::mmap(nullptr, sizeof(Ring) + kAltStackSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        Ring *ring = new (mem) Ring;
+        ring->owner.store(tid, std::memory_order_relaxed);
+        ring->next.store(0, std::memory_order_relaxed);
+        g_rings[index].store(ring, std::memory_order_release);
+        return ring;
+    }
+
+    Ring *createRing()
+    {
+        static std::once_flag installed;
+        if (!FlightRecorder::enabled())
+        {
+            return nullptr;
+        }
+        std::call_once(installed, installCrashHandlers);
+        Ring *ring = acquireRing();
+        if (ring == nullptr)
+        {
+            return nullptr;
+        }
+        if (::prctl(PR_GET_NAME, ring->name) != 0)
+        {
+            ring->name[0] = '\0';
+        }
+        setAltStack(ring);
+        (void)&t_releaser; // 使用一次，线程退出时才会析构
+        return ring;
+    }
+
+    /**
+     * @brief 信号处理函数中不能用stdio，拼好一行后直接write
+     */
+    class LineWriter
+    {
+    public:
+        explicit LineWriter(int fd) : fd_(fd), len_(0) {}
+
+        LineWriter &str(const char *s)
+        {
+            size_t n = strlen(s);
+            if (n > sizeof buf_ - len_)
+            {
+                n = sizeof buf_ - len_;
+            }
+            memcpy(buf_ + len_, s, n);
+            len_ += n;
+            return *this;
+        }
+
+        LineWriter &num(int64_t v)
+        {
+            if (sizeof buf_ - len_ >= LogStream::kMaxNumericSize)
+            {
+                len_ += LogStream::convert(buf_ + len_, static_cast<long long>(v));
+            }
+            return *this;
+        }
+
+        void flush()
+        {
+            str("\n");
+            size_t written = 0;
+            while (written < len_)
+            {
+                ssize_t n = ::write(fd_, buf_ + written, len_ - written);
+                if (n <= 0)
+                {
+                    break;
+                }
+                written += n;
+            }
+            len_ = 0;
+        }
+
+    private:
+        int fd_;
+        size_t len_;
+        char buf_[256];
+    };
+
+    void writeEvent(LineWriter &out, uint64_t seq, const Event &e, int64_t nowUs)
+    {
+        out.str("  #").num(static_cast<int64_t>(seq));
+        if (e.timeUs != 0)
+        {
+            out.str(" t-").num(nowUs - e.timeUs).str("us");
+        }
+        if (e.type >= FlightRecorder::kNumEventTypes)
+        {
+            out.str(" ?").flush();
+            return;
+        }
+        out.str(" ").str(kEventNames[e.type].name);
+        if (e.fd >= 0)
+        {
+            out.str(" fd=").num(e.fd);
+        }
+        if (e.type == FlightRecorder::kConnUp)
+        {
+            const unsigned char *ip = reinterpret_cast<const unsigned char *>(&e.a);
+            out.str(" peer=").num(ip[0]).str(".").num(ip[1]).str(".").num(ip[2]).str(".").num(ip[3]).str(":").num(e.b);
+        }
+        else
+        {
+            if (kEventNames[e.type].a != nullptr)
+            {
+                out.str(" ").str(kEventNames[e.type].a).str("=").num(e.a);
+            }
+            if (kEventNames[e.type].b != nullptr)
+            {
+                out.str(" ").str(kEventNames[e.type].b).str("=").num(e.b);
+            }
+        }
+        out.flush();
+    }
+}
+
+bool FlightRecorder::enabled()
+{
+    static const bool enabled = ::getenv("MUDUO_NO_FLIGHT_RECORDER") == nullptr;
+    return enabled;
+}
+
+void FlightRecorder::record(EventType type, int fd, int64_t a, int64_t b)
+{
+    Ring *ring = t_ring;
+    if (__builtin_expect(ring == nullptr, 0))
+    {
+        if (t_unavailable)
+        {
+            return;
+        }
+        ring = t_ring = createRing();
+        if (ring == nullptr)
+        {
+            t_unavailable = true;
+            return;
+        }
+    }
+    const uint64_t n = ring->next.load(std::memory_order_relaxed);
+    Event &e = ring->events[n & (kEventsPerThread - 1)];
+    e.timeUs = t_timeUs;
+    e.type = type;
+    e.fd = fd;
+    e.a = a;
+    e.b = b;
+    ring->next.store(n + 1, std::memory_order_release);
+}
+
+void FlightRecorder::setTime(int64_t monotonicUs)
+{
+    t_timeUs = monotonicUs;
+}
+
+void FlightRecorder::dump(int fd, int maxEventsPerThread)
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    const int64_t nowUs = static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 + ts.tv_nsec / 1000;
+
+    LineWriter out(fd);
+    out.str("==== flight recorder: most recent events per thread, t- is time before this dump ====").flush();
+    const int numRings = std::min(g_numRings.load(std::memory_order_acquire), static_cast<int>(kMaxThreads));
+    for (int i = 0; i < numRings; ++i)
+    {
+        const Ring *ring = g_rings[i].load(std::memory_order_acquire);
+        if (ring == nullptr)
+        {
+            continue;
+        }
+        const uint64_t n = ring->next.load(std::memory_order_acquire);
+        if (n == 0)
+        {
+            continue;
+        }
+        const int owner = ring->owner.load(std::memory_order_relaxed);
+        out.str("-- thread ");
+        if (owner != 0)
+        {
+            out.num(owner);
+        }
+        else
+        {
+            out.str("(exited)");
+        }
+        out.str(" ").str(ring->name).str(" events=").num(static_cast<int64_t>(n)).flush();
+
+        uint64_t limit = static_cast<uint64_t>(maxEventsPerThread < kEventsPerThread ? maxEventsPerThread : kEventsPerThread);
+        for (uint64_t seq = n > limit ? n - limit : 0; seq < n; ++seq)
+        {
+            writeEvent(out, seq, ring->events[seq & (kEventsPerThread - 1)], nowUs);
+        }
+    }
+    out.str("==== end of flight recorder ====").flush();
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "noncopyable.h"
+
+#include <stdint.h>
+
+/**
+ * @brief 常开的飞行记录器：每个线程一个mmap出来的定长环，记录最近的事件(连接建立/关闭、epoll返回的事件数、
+ * 收发的字节数、accept和socket错误)。每条事件32字节，记录只是线程局部的几次存储，不加锁、不读时钟，
+ * 时间取所在loop最近一次poll返回的时间(FlightRecorder::setTime)。
+ * 进程收到SIGSEGV/SIGBUS/SIGFPE/SIGILL/SIGABRT或者LOG_FATAL时，把每个线程的环中最近的事件写到stderr，
+ * 不需要DEBUG版本也能看到崩溃前发生了什么。
+ * 环不在malloc的堆上，堆被破坏时仍然可以读取；导出只使用write，可以在信号处理函数中执行。
+ * 信号处理函数只在该信号还是默认处理方式时安装，不覆盖程序自己的处理函数。
+ * 设置环境变量MUDUO_NO_FLIGHT_RECORDER时关闭
+ */
+class FlightRecorder : noncopyable
+{
+public:
+    enum EventType : uint32_t
+    {
+        kPoll,      // a=返回的事件数
+        kConnUp,    // a=对端ip(网络字节序)，b=对端端口
+        kConnDown,  // a=连接状态
+        kRead,      // a=读到的字节数，b=errno
+        kSend,      // a=要发送的字节数，b=直接写出的字节数
+        kWrite,     // 可写事件：a=写出的字节数，b=缓冲区中剩下的字节数
+        kAccept,    // fd=新连接，a=errno
+        kError,     // a=SO_ERROR
+        kUser,      // 程序自己的事件
+        kNumEventTypes,
+    };
+
+    static const int kEventsPerThread = 4096; // 每个线程的环能放的事件数，128KB
+    static const int kMaxThreads = 256;       // 最多同时记录的线程数，退出的线程的环留给之后的线程
+    static const int kDumpEventsPerThread = 256;
+
+    /**
+     * @brief 记录一个事件到当前线程的环，第一次调用时创建环
+     */
+    static void record(EventType type, int fd, int64_t a = 0, int64_t b = 0);
+
+    /**
+     * @brief 设置当前线程之后记录的事件的时间(单调时钟，微秒)，EventLoop每次poll返回时调用
+     */
+    static void setTime(int64_t monotonicUs);
+
+    /**
+     * @brief 把所有线程的环中最近的事件写到fd，每个线程最多maxEventsPerThread条。
+     * 只使用write，可以在信号处理函数中调用；此时其它线程可能正在写，个别事件可能不完整
+     */
+    static void dump(int fd, int maxEventsPerThread = kDumpEventsPerThread);
+
+    static bool enabled();
+};
@@ -26,12 +26,43 @@ std::string InetAddr::toIp() const
 
 std::string InetAddr::toIpPort() const
 {
-    char buf[64] = {0};
-    ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
-    size_t end = strlen(buf);
-    uint16_t port = ntohs(addr_.sin_port);
-    sprintf(buf + end, ":%u", port);
-    return buf;
+    char buf[kMaxIpPortLen];
+    size_t len = toIpPort(buf);
+    return std::string(buf, len);
+}
+
+namespace
+{
+    // 写入0~65535的十进制数，返回长度
+    size_t formatUint16(char *buf, unsigned value)
+    {
+        char tmp[5];
+        size_t n = 0;
+        do
+        {
+            tmp[n++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            buf[i] = tmp[n - 1 - i];
+        }
+        return n;
+    }
+}
+
+size_t InetAddr::toIpPort(char *buf) const
+{
+    const unsigned char *ip = reinterpret_cast<const unsigned char *>(&addr_.sin_addr.s_addr); // 网络字节序
+    size_t len = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        len += formatUint16(buf + len, ip[i]);
+        buf[len++] = i < 3 ? '.' : ':';
+    }
+    len += formatUint16(buf + len, ntohs(addr_.sin_port));
+    buf[len] = '\0';
+    return len;
 }
 
 uint16_t InetAddr::toPort() const
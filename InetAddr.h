@@ -17,6 +17,9 @@ public:
 
     std::string toIp() const;
     std::string toIpPort() const;
+    static const size_t kMaxIpPortLen = 24; // "255.255.255.255:65535"加上'\0'
+    // 写入"ip:port"，buf至少kMaxIpPortLen字节，返回长度(不包括'\0')，不分配内存
+    size_t toIpPort(char *buf) const;
     uint16_t toPort() const;
 
     const sockaddr *getSockaddr() const;
@@ -0,0 +1,818 @@
+#include "IoUringPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <algorithm>
+
+// channel未添加到poller中
+const int kNew = -1;
+// channel已经添加到poller中
+const int kAdded = 1;
+// channel在poller中但不关心任何事件
+const int kDeleted = 2;
+
+// 提交队列的长度
+const unsigned kRingEntries = 1024;
+// 删除/修改poll请求的user_data，它们的完成事件直接忽略。fd非负，不会与makeUserData冲突
+const uint64_t kInternalUserData = ~0ULL;
+
+static int ioUringSetup(unsigned entries, struct io_uring_params *params)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int ringfd, unsigned toSubmit, unsigned minComplete, unsigned flags, const void *arg, size_t argsz)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit, minComplete, flags, arg, argsz));
+}
+
+static int ioUringRegister(int ringfd, unsigned opcode, void *arg, unsigned nrArgs)
+{
+    return static_cast<int>(::syscall(__NR_io_uring_register, ringfd, opcode, arg, nrArgs));
+}
+
+// provided buffer ring的组号，整个io_uring只有一组
+const uint16_t kBufferGroup = 0;
+
+// 只影响单个连接的accept错误，multishot accept因此结束后重新提交；其它错误(如EMFILE)由Acceptor决定何时重新开始
+static bool isTransientAcceptError(int err)
+{
+    return err == ECONNABORTED || err == EINTR || err == EPROTO || err == EPERM || err == EAGAIN;
+}
+
+/**
+ * @brief 创建io_uring实例。需要的内核特性：
+ * IORING_FEAT_SINGLE_MMAP、IORING_FEAT_NODROP、IORING_FEAT_EXT_ARG(带超时的等待，5.11)、
+ * IORING_FEAT_RSRC_TAGS(与POLL_REMOVE的UPDATE_EVENTS同在5.13引入，用来判断是否支持修改poll)
+ */
+IoUringPoller *IoUringPoller::create(EventLoop *loop)
+{
+    return create(loop, false);
+}
+
+IoUringPoller *IoUringPoller::create(EventLoop *loop, bool completionMode)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof params);
+    int ringfd = ioUringSetup(kRingEntries, &params);
+    if (ringfd < 0)
+    {
+        LOG_INFO("io_uring_setup failed:%d \n", errno);
+        return nullptr;
+    }
+
+    const unsigned required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG | IORING_FEAT_RSRC_TAGS;
+    if ((params.features & required) != required)
+    {
+        LOG_INFO("io_uring features 0x%x lack required 0x%x \n", params.features, required);
+        ::close(ringfd);
+        return nullptr;
+    }
+
+    IoUringPoller *poller = new IoUringPoller(loop, ringfd, params.sq_entries);
+    if (!poller->setupRings(&params))
+    {
+        delete poller;
+        return nullptr;
+    }
+    if (completionMode && !poller->setupBufferRing())
+    {
+        LOG_INFO("io_uring provided buffer ring is not available, use readiness mode only \n");
+    }
+    return poller;
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop, int ringfd, unsigned entries)
+    : Poller(loop),
+      ringfd_(ringfd),
+      entries_(entries),
+      sqRing_(nullptr),
+      sqRingSize_(0),
+      cqRing_(nullptr),
+      cqRingSize_(0),
+      sqes_(nullptr),
+      sqesSize_(0),
+      pendingSubmit_(0),
+      completionMode_(false),
+      bufRing_(nullptr),
+      bufRingSize_(0),
+      recvBuffers_(nullptr),
+      bufRingTail_(0)
+{
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    if (sqes_ != nullptr)
+    {
+        ::munmap(sqes_, sqesSize_);
+    }
+    // IORING_FEAT_SINGLE_MMAP：SQ与CQ共用一块映射
+    if (sqRing_ != nullptr)
+    {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    ::close(ringfd_);
+    // 关闭io_uring之后内核不再使用provided buffer
+    if (bufRing_ != nullptr)
+    {
+        ::munmap(bufRing_, bufRingSize_);
+    }
+    if (recvBuffers_ != nullptr)
+    {
+        ::munmap(recvBuffers_, static_cast<size_t>(kRecvBuffers) * kRecvBufferSize);
+    }
+}
+
+/**
+ * @brief 映射SQ/CQ和SQE数组，并取出各个字段的地址
+ */
+bool IoUringPoller::setupRings(const void *p)
+{
+    const struct io_uring_params *params = static_cast<const struct io_uring_params *>(p);
+
+    size_t sqSize = params->sq_off.array + params->sq_entries * sizeof(unsigned);
+    size_t cqSize = params->cq_off.cqes + params->cq_entries * sizeof(struct io_uring_cqe);
+    sqRingSize_ = std::max(sqSize, cqSize);
+    void *ring = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQ_RING);
+    if (ring == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap ring error:%d \n", errno);
+        return false;
+    }
+    sqRing_ = ring;
+    cqRing_ = ring;
+    cqRingSize_ = sqRingSize_;
+
+    sqesSize_ = params->sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes = ::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap sqes error:%d \n", errno);
+        return false;
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params->sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params->sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(sq + params->sq_off.ring_mask);
+    sqFlags_ = reinterpret_cast<unsigned *>(sq + params->sq_off.flags);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params->sq_off.array);
+
+    char *cq = static_cast<char *>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params->cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params->cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(cq + params->cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + params->cq_off.cqes);
+    return true;
+}
+
+/**
+ * @brief 分配接收缓冲区和provided buffer ring并注册到内核(IORING_REGISTER_PBUF_RING，5.19)，
+ * 成功后开启完成模式
+ */
+bool IoUringPoller::setupBufferRing()
+{
+    bufRingSize_ = kRecvBuffers * sizeof(struct io_uring_buf);
+    void *ring = ::mmap(nullptr, bufRingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap buffer ring error:%d \n", errno);
+        return false;
+    }
+    bufRing_ = static_cast<io_uring_buf_ring *>(ring);
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof reg);
+    reg.ring_addr = reinterpret_cast<uint64_t>(bufRing_);
+    reg.ring_entries = kRecvBuffers;
+    reg.bgid = kBufferGroup;
+    if (ioUringRegister(ringfd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        LOG_INFO("io_uring register buffer ring failed:%d \n", errno);
+        return false;
+    }
+
+    void *buffers = ::mmap(nullptr, static_cast<size_t>(kRecvBuffers) * kRecvBufferSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED)
+    {
+        LOG_ERROR("io_uring mmap recv buffers error:%d \n", errno);
+        return false;
+    }
+    recvBuffers_ = static_cast<char *>(buffers);
+    for (unsigned bid = 0; bid < kRecvBuffers; ++bid)
+    {
+        recycleBuffer(bid);
+    }
+    completionMode_ = true;
+    return true;
+}
+
+/**
+ * @brief 把缓冲区放回provided buffer ring，内核通过tail看到新加入的缓冲区
+ */
+void IoUringPoller::recycleBuffer(unsigned bid)
+{
+    // 不使用bufRing_->bufs：__DECLARE_FLEX_ARRAY在C++中多出一个空结构体成员，bufs的偏移不是0
+    struct io_uring_buf *buf = reinterpret_cast<struct io_uring_buf *>(bufRing_) + (bufRingTail_ & (kRecvBuffers - 1));
+    buf->addr = reinterpret_cast<uint64_t>(recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize);
+    buf->len = kRecvBufferSize;
+    buf->bid = static_cast<uint16_t>(bid);
+    ++bufRingTail_;
+    __atomic_store_n(&bufRing_->tail, bufRingTail_, __ATOMIC_RELEASE);
+}
+
+IoUringPoller::FdState &IoUringPoller::fdState(int fd)
+{
+    if (static_cast<size_t>(fd) >= fdStates_.size())
+    {
+        FdState init = {0, false, false};
+        fdStates_.resize(std::max(static_cast<size_t>(fd) + 1, fdStates_.size() * 2), init);
+    }
+    return fdStates_[fd];
+}
+
+/**
+ * @brief 取一个空闲的SQE。没有SQPOLL线程，内核只在io_uring_enter时读取SQE，所以可以先移动tail再填写
+ */
+io_uring_sqe *IoUringPoller::getSqe()
+{
+    unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries_)
+    {
+        // 提交队列满了，先把已有的请求提交给内核
+        submitPending();
+        if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= entries_)
+        {
+            LOG_FATAL("io_uring submission queue is full \n");
+        }
+    }
+    unsigned index = tail & *sqMask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0, sizeof *sqe);
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++pendingSubmit_;
+    return sqe;
+}
+
+void IoUringPoller::submitPending()
+{
+    if (pendingSubmit_ == 0)
+    {
+        return;
+    }
+    int ret = ioUringEnter(ringfd_, pendingSubmit_, 0, 0, nullptr, 0);
+    if (ret < 0)
+    {
+        LOG_ERROR("io_uring_enter submit error:%d \n", errno);
+        return;
+    }
+    pendingSubmit_ -= std::min(pendingSubmit_, static_cast<unsigned>(ret));
+}
+
+/**
+ * @brief 提交一个oneshot的poll请求
+ */
+void IoUringPoller::armPoll(Channel *channel)
+{
+    int fd = channel->fd();
+    FdState &state = fdState(fd);
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = static_cast<uint32_t>(channel->events());
+    sqe->user_data = makeUserData(fd, state.generation);
+    state.armed = true;
+}
+
+/**
+ * @brief 修改内核中poll请求关心的事件
+ */
+void IoUringPoller::updatePoll(Channel *channel)
+{
+    int fd = channel->fd();
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, fdState(fd).generation);
+    sqe->len = IORING_POLL_UPDATE_EVENTS;
+    sqe->poll32_events = static_cast<uint32_t>(channel->events());
+    sqe->user_data = kInternalUserData;
+}
+
+/**
+ * @brief 取消内核中的poll请求，递增generation使其已经产生的完成事件被丢弃
+ */
+void IoUringPoller::cancelPoll(int fd)
+{
+    FdState &state = fdState(fd);
+    if (state.armed)
+    {
+        io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = makeUserData(fd, state.generation);
+        sqe->user_data = kInternalUserData;
+        state.armed = false;
+    }
+    ++state.generation;
+}
+
+/**
+ * @brief 上一轮触发过的channel重新提交poll，使用它们当前的events
+ */
+void IoUringPoller::rearmFired()
+{
+    for (int fd : fired_)
+    {
+        FdState &state = fdStates_[fd];
+        state.queued = false;
+        if (state.armed)
+        {
+            continue;
+        }
+        Channel *channel = findChannel(fd);
+        if (channel != nullptr && channel->index() == kAdded && !channel->isNoneEvent())
+        {
+            armPoll(channel);
+        }
+    }
+    fired_.clear();
+}
+
+/**
+ * @brief 取出所有完成事件，转换成channel的revents
+ */
+void IoUringPoller::reapCompletions(ChannelList *activeChannels)
+{
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head)
+    {
+        const io_uring_cqe *cqe = &cqes_[head & *cqMask_];
+        uint64_t userData = cqe->user_data;
+        if (userData == kInternalUserData)
+        {
+            continue;
+        }
+        if (userData & kCompletionBit)
+        {
+            // 完成模式的结果在dispatchEvents中交付，拿着的缓冲区也在那里归还
+            Completion c = {userData, cqe->res, cqe->flags};
+            completed_.push_back(c);
+            continue;
+        }
+        int fd = static_cast<int>(static_cast<uint32_t>(userData));
+        uint32_t generation = static_cast<uint32_t>(userData >> 32);
+        if (static_cast<size_t>(fd) >= fdStates_.size() || fdStates_[fd].generation != generation)
+        {
+            continue; // 已经删除或重新注册过的请求
+        }
+
+        FdState &state = fdStates_[fd];
+        state.armed = false;
+        if (!state.queued)
+        {
+            state.queued = true;
+            fired_.push_back(fd);
+        }
+
+        Channel *channel = findChannel(fd);
+        if (channel == nullptr)
+        {
+            continue;
+        }
+        if (cqe->res < 0)
+        {
+            // 被内核取消的请求重新提交即可，其它错误交给channel的错误回调
+            if (cqe->res == -ECANCELED)
+            {
+                continue;
+            }
+            LOG_ERROR("io_uring poll fd=%d error:%d \n", fd, -cqe->res);
+            channel->setRevents(POLLERR);
+        }
+        else
+        {
+            channel->setRevents(cqe->res);
+        }
+        activeChannels->push_back(channel);
+    }
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief 提交所有积攒的请求并等待完成事件，一次io_uring_enter
+ * @param timeout nullptr表示一直阻塞
+ */
+Timestamp IoUringPoller::waitEvents(const struct timespec *timeout, ChannelList *activeChannels)
+{
+    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, numChannels());
+    rearmFired();
+
+    bool hasCompletions = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE) != *cqHead_;
+    bool noWait = timeout != nullptr && timeout->tv_sec == 0 && timeout->tv_nsec == 0;
+    unsigned minComplete = (hasCompletions || noWait) ? 0 : 1;
+
+    int ret;
+    if (timeout != nullptr && minComplete > 0)
+    {
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof arg);
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(timeout);
+        ret = ioUringEnter(ringfd_, pendingSubmit_, minComplete, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof arg);
+    }
+    else
+    {
+        ret = ioUringEnter(ringfd_, pendingSubmit_, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+    int saveErrno = errno;
+    Timestamp now(Timestamp::now());
+
+    if (ret >= 0)
+    {
+        pendingSubmit_ -= std::min(pendingSubmit_, static_cast<unsigned>(ret));
+    }
+    else if (saveErrno != ETIME && saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("IoUringPoller::poll() err:%d \n", saveErrno);
+    }
+
+    reapCompletions(activeChannels);
+    // 完成队列溢出时内核把事件暂存在溢出链表里，再进入一次内核把它们刷到完成队列
+    if (__atomic_load_n(sqFlags_, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)
+    {
+        ioUringEnter(ringfd_, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0);
+        reapCompletions(activeChannels);
+    }
+
+    if (!activeChannels->empty())
+    {
+        LOG_INFO("%lu events happend \n", activeChannels->size());
+    }
+    else
+    {
+        LOG_DEBUG("%s timeout\n", __FUNCTION__);
+    }
+    return now;
+}
+
+Timestamp IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    if (timeoutMs < 0)
+    {
+        return waitEvents(nullptr, activeChannels);
+    }
+    struct timespec ts;
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = static_cast<long>(timeoutMs % 1000) * 1000 * 1000;
+    return waitEvents(&ts, activeChannels);
+}
+
+Timestamp IoUringPoller::pollPrecise(int64_t timeoutUs, ChannelList *activeChannels)
+{
+    if (timeoutUs < 0)
+    {
+        return waitEvents(nullptr, activeChannels);
+    }
+    struct timespec ts;
+    ts.tv_sec = static_cast<time_t>(timeoutUs / Timestamp::kMicroSecondsPerSecond);
+    ts.tv_nsec = static_cast<long>((timeoutUs % Timestamp::kMicroSecondsPerSecond) * 1000);
+    return waitEvents(&ts, activeChannels);
+}
+
+/**
+ * @brief 更新channel管理的fd对应的事件，只写入提交队列，下一次poll时统一提交
+ */
+void IoUringPoller::updateChannel(Channel *channel)
+{
+    const int index = channel->index();
+    const int fd = channel->fd();
+    LOG_INFO("func=%s fd=%d events=%d index=%d \n", __FUNCTION__, fd, channel->events(), index);
+
+    FdState &state = fdState(fd);
+    if (index == kNew || index == kDeleted)
+    {
+        if (index == kNew)
+        {
+            insertChannel(channel);
+        }
+        channel->setIndex(kAdded);
+        cancelPoll(fd); // 丢弃旧请求可能残留的完成事件
+        if (!channel->isNoneEvent())
+        {
+            armPoll(channel);
+        }
+    }
+    else if (channel->isNoneEvent())
+    {
+        cancelPoll(fd);
+        channel->setIndex(kDeleted);
+    }
+    else if (state.armed)
+    {
+        updatePoll(channel);
+    }
+    else if (!state.queued)
+    {
+        armPoll(channel);
+    }
+    // 否则刚刚触发过、等待rearmFired用最新的events重新提交
+}
+
+/**
+ * @brief 从poller中删除Channel，同时停止它的完成模式请求
+ */
+void IoUringPoller::removeChannle(Channel *channel)
+{
+    const int fd = channel->fd();
+    LOG_INFO("func=%s fd=%d ", __FUNCTION__, fd);
+    eraseChannel(channel);
+    cancelPoll(fd);
+    channel->setIndex(kNew);
+    if (static_cast<size_t>(fd) < ops_.size() && ops_[fd])
+    {
+        stopCompletion(channel);
+        ++ops_[fd]->generation; // 之后的完成事件(包括本轮未交付的accept批次结束)都不再属于该channel
+    }
+}
+
+IoUringPoller::CompletionOp *IoUringPoller::completionOp(int fd)
+{
+    if (static_cast<size_t>(fd) >= ops_.size())
+    {
+        ops_.resize(std::max(static_cast<size_t>(fd) + 1, ops_.size() * 2));
+    }
+    if (!ops_[fd])
+    {
+        ops_[fd].reset(new CompletionOp);
+    }
+    return ops_[fd].get();
+}
+
+/**
+ * @brief 提交multishot accept或multishot recv(从provided buffer ring中选择缓冲区)
+ */
+void IoUringPoller::armCompletion(int fd, CompletionOp *op)
+{
+    io_uring_sqe *sqe = getSqe();
+    sqe->fd = fd;
+    sqe->user_data = makeCompletionData(fd, op->generation, op->accept);
+    if (op->accept)
+    {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    }
+    else
+    {
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = kBufferGroup;
+    }
+    op->armed = true;
+}
+
+bool IoUringPoller::startAccept(Channel *channel, AcceptCompletionCallback onAccept, CompletionBatchEndCallback onBatchEnd)
+{
+    if (!completionMode_)
+    {
+        return false;
+    }
+    stopCompletion(channel);
+    CompletionOp *op = completionOp(channel->fd());
+    ++op->generation;
+    op->accept = true;
+    op->active = true;
+    op->onAccept = std::move(onAccept);
+    op->onBatchEnd = std::move(onBatchEnd);
+    armCompletion(channel->fd(), op);
+    return true;
+}
+
+bool IoUringPoller::startRecv(Channel *channel, RecvCompletionCallback onRecv, CompletionBatchEndCallback onBatchEnd)
+{
+    if (!completionMode_)
+    {
+        return false;
+    }
+    stopCompletion(channel);
+    CompletionOp *op = completionOp(channel->fd());
+    ++op->generation;
+    op->accept = false;
+    op->active = true;
+    op->onRecv = std::move(onRecv);
+    op->onBatchEnd = std::move(onBatchEnd);
+    armCompletion(channel->fd(), op);
+    return true;
+}
+
+bool IoUringPoller::startSend(Channel *channel, SendCompletionCallback onSend)
+{
+    if (!completionMode_)
+    {
+        return false;
+    }
+    completionOp(channel->fd())->onSend = std::move(onSend);
+    return true;
+}
+
+/**
+ * @brief 提交一个IORING_OP_SEND，和本轮其它请求一起在下一次io_uring_enter中提交。
+ * MSG_WAITALL让内核在socket缓冲区满时等待可写后继续发送，通常一次完成全部数据
+ */
+void IoUringPoller::submitSend(Channel *channel, const char *data, size_t len, const std::shared_ptr<void> &owner)
+{
+    const int fd = channel->fd();
+    CompletionOp *op = completionOp(fd);
+    int slot;
+    if (freeSends_.empty())
+    {
+        slot = static_cast<int>(sends_.size());
+        sends_.push_back(SendSlot());
+    }
+    else
+    {
+        slot = freeSends_.back();
+        freeSends_.pop_back();
+    }
+    sends_[slot].fd = fd;
+    sends_[slot].owner = owner;
+    op->sendSlot = slot;
+
+    io_uring_sqe *sqe = getSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(data);
+    sqe->len = static_cast<uint32_t>(std::min(len, static_cast<size_t>(1U << 30))); // 超过的部分由调用者在完成后继续发送
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = kCompletionBit | kSendBit | static_cast<uint32_t>(slot);
+}
+
+/**
+ * @brief 取消内核中的multishot请求和在途的send。generation不变，本轮已经交付过的结果仍然会调用onBatchEnd，
+ * 但不再调用onAccept/onRecv/onSend(已经accept的连接直接关闭)。回调对象保留到下次start时才替换，
+ * 所以可以在回调中调用
+ */
+void IoUringPoller::stopCompletion(Channel *channel)
+{
+    const int fd = channel->fd();
+    if (static_cast<size_t>(fd) >= ops_.size() || !ops_[fd])
+    {
+        return;
+    }
+    CompletionOp *op = ops_[fd].get();
+    op->active = false;
+    if (op->armed)
+    {
+        io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = makeCompletionData(fd, op->generation, op->accept);
+        sqe->user_data = kInternalUserData;
+        op->armed = false;
+    }
+    if (op->sendSlot >= 0)
+    {
+        io_uring_sqe *sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = kCompletionBit | kSendBit | static_cast<uint32_t>(op->sendSlot);
+        sqe->user_data = kInternalUserData;
+        op->sendSlot = -1; // 数据和owner保留到完成事件到达
+    }
+}
+
+/**
+ * @brief 先分发就绪事件，再交付完成模式的结果
+ */
+void IoUringPoller::dispatchEvents(Timestamp receiveTime, ChannelList *activeChannels)
+{
+    Poller::dispatchEvents(receiveTime, activeChannels);
+    if (!completed_.empty())
+    {
+        dispatchCompletions(receiveTime);
+    }
+}
+
+void IoUringPoller::dispatchCompletions(Timestamp receiveTime)
+{
+    // 本轮交付过结果的fd及其generation，全部交付后各调用一次onBatchEnd
+    std::vector<std::pair<int, uint32_t>> batches;
+    for (size_t i = 0; i < completed_.size(); ++i)
+    {
+        const Completion c = completed_[i];
+        if (c.userData & kSendBit)
+        {
+            completeSend(static_cast<int>(static_cast<uint32_t>(c.userData)), c.res);
+            continue;
+        }
+        const int fd = static_cast<int>(static_cast<uint32_t>(c.userData));
+        const uint32_t generation = static_cast<uint32_t>(c.userData >> 32) & kGenerationMask;
+        const bool accept = (c.userData & kAcceptBit) != 0;
+        const bool more = (c.flags & IORING_CQE_F_MORE) != 0;
+        const bool hasBuffer = (c.flags & IORING_CQE_F_BUFFER) != 0;
+        const unsigned bid = c.flags >> IORING_CQE_BUFFER_SHIFT;
+
+        CompletionOp *op = static_cast<size_t>(fd) < ops_.size() ? ops_[fd].get() : nullptr;
+        const bool current = op != nullptr && (op->generation & kGenerationMask) == generation;
+        if (current && !more)
+        {
+            op->armed = false;
+        }
+        if (!current || !op->active)
+        {
+            // 已经停止的请求：归还缓冲区，已经accept的连接没有人接收，直接关闭
+            if (hasBuffer)
+            {
+                recycleBuffer(bid);
+            }
+            if (accept && c.res >= 0)
+            {
+                ::close(c.res);
+            }
+            continue;
+        }
+
+        if (!op->inBatch && c.res != -ENOBUFS)
+        {
+            op->inBatch = true;
+            batches.push_back(std::make_pair(fd, op->generation));
+        }
+        if (accept)
+        {
+            op->onAccept(c.res >= 0 ? c.res : -1, c.res >= 0 ? 0 : -c.res);
+        }
+        else if (c.res != -ENOBUFS)
+        {
+            const char *data = hasBuffer ? recvBuffers_ + static_cast<size_t>(bid) * kRecvBufferSize : nullptr;
+            op->onRecv(data, c.res >= 0 ? c.res : -1, c.res >= 0 ? 0 : -c.res, receiveTime);
+        }
+        if (hasBuffer)
+        {
+            recycleBuffer(bid);
+        }
+
+        // multishot被内核结束(缓冲区用完、CQ溢出等)而用户没有停止时重新提交；recv在EOF和错误之后不再继续
+        op = ops_[fd].get();
+        if (!more && op->active && !op->armed && (op->generation & kGenerationMask) == generation)
+        {
+            if (accept ? (c.res >= 0 || isTransientAcceptError(-c.res)) : (c.res > 0 || c.res == -ENOBUFS))
+            {
+                armCompletion(fd, op);
+            }
+            else
+            {
+                op->active = false;
+            }
+        }
+    }
+    completed_.clear();
+
+    for (size_t i = 0; i < batches.size(); ++i)
+    {
+        CompletionOp *op = ops_[batches[i].first].get();
+        op->inBatch = false;
+        if (op->generation == batches[i].second && op->onBatchEnd)
+        {
+            op->onBatchEnd();
+        }
+    }
+}
+
+/**
+ * @brief send完成：先释放slot再调用onSend，回调中可以立即提交下一次send。
+ * 已经停止的send只释放slot，owner在回调之后释放，连接可能在这里析构
+ */
+void IoUringPoller::completeSend(int slot, int32_t res)
+{
+    const int fd = sends_[slot].fd;
+    std::shared_ptr<void> owner;
+    owner.swap(sends_[slot].owner);
+    freeSends_.push_back(slot);
+
+    CompletionOp *op = static_cast<size_t>(fd) < ops_.size() ? ops_[fd].get() : nullptr;
+    if (op != nullptr && op->sendSlot == slot)
+    {
+        op->sendSlot = -1;
+        if (op->onSend)
+        {
+            op->onSend(res >= 0 ? res : -1, res >= 0 ? 0 : -res);
+        }
+    }
+}
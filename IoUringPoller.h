@@ -0,0 +1,181 @@
+#pragma once
+#include "Poller.h"
+#include "Timestamp.h"
+
+#include <vector>
+#include <memory>
+#include <stdint.h>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+struct timespec;
+class Channel;
+
+/**
+ * @brief 基于io_uring的Poller（就绪通知模式）。
+ * 每个channel对应一个IORING_OP_POLL_ADD请求，兴趣变化通过IORING_OP_POLL_REMOVE(UPDATE_EVENTS)修改，
+ * 所有请求先写入提交队列，和等待事件合并成每次迭代一次io_uring_enter，不再有epoll_ctl的系统调用。
+ *
+ * poll请求使用oneshot并在事件分发后重新提交：multishot poll只在状态变化时通知（边沿触发），
+ * IORING_POLL_ADD_LEVEL也不能与IORING_POLL_ADD_MULTI同时使用(返回EINVAL)，
+ * 而TcpConnection/Acceptor的读写处理依赖epoll的水平触发语义。重新提交的poll会立即检查当前状态，
+ * 与水平触发等价，且重新提交同样合并在下一次io_uring_enter中。
+ *
+ * 以完成模式创建时另外支持Poller::startAccept/startRecv：监听socket上提交一个multishot accept，
+ * 连接上提交一个multishot recv，数据由内核直接读入注册的provided buffer ring(kRecvBuffers个kRecvBufferSize
+ * 字节的缓冲区，所有连接共用)，回调拷贝走数据后缓冲区立即归还。发送通过submitSend提交IORING_OP_SEND，
+ * 与其它请求一起在下一次io_uring_enter中提交，完成后调用startSend登记的回调。
+ * multishot recv需要6.0以上的内核；缓冲区暂时用完(ENOBUFS)时内核结束multishot，分发后重新提交。
+ *
+ * 通过IoUringPoller::create创建，内核不支持时返回nullptr，由newDefaultPolle回退到EpollPoller。
+ */
+class IoUringPoller : public Poller
+{
+public:
+    ~IoUringPoller() override;
+
+    /**
+     * @brief 创建io_uring实例，内核不支持io_uring或缺少需要的特性时返回nullptr
+     */
+    static IoUringPoller *create(EventLoop *loop);
+    /**
+     * @brief completionMode为true时注册provided buffer ring并开启完成模式，注册失败时只使用就绪通知
+     */
+    static IoUringPoller *create(EventLoop *loop, bool completionMode);
+
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    Timestamp pollPrecise(int64_t timeoutUs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannle(Channel *channel) override;
+    void dispatchEvents(Timestamp receiveTime, ChannelList *activeChannels) override;
+
+    bool startAccept(Channel *channel, AcceptCompletionCallback onAccept, CompletionBatchEndCallback onBatchEnd) override;
+    bool startRecv(Channel *channel, RecvCompletionCallback onRecv, CompletionBatchEndCallback onBatchEnd) override;
+    bool startSend(Channel *channel, SendCompletionCallback onSend) override;
+    void submitSend(Channel *channel, const char *data, size_t len, const std::shared_ptr<void> &owner) override;
+    void stopCompletion(Channel *channel) override;
+
+    // provided buffer ring的缓冲区个数(2的幂)与每个缓冲区的大小
+    static const unsigned kRecvBuffers = 256;
+    static const unsigned kRecvBufferSize = 4096;
+
+private:
+    /**
+     * @brief 每个fd的poll请求状态，按fd下标存放
+     */
+    struct FdState
+    {
+        uint32_t generation; // 每次重新注册时递增，用于丢弃已经删除的请求的完成事件
+        bool armed;          // 内核中是否有该fd的poll请求
+        bool queued;         // 是否已经在fired_中等待重新提交
+    };
+
+    /**
+     * @brief 完成模式下一个fd上的multishot accept/recv，按fd下标存放
+     */
+    struct CompletionOp
+    {
+        uint32_t generation = 0; // 每次start/删除时递增，用于丢弃旧请求的完成事件
+        bool accept = false;     // accept还是recv
+        bool active = false;     // 用户是否还需要结果(start之后、stop之前)
+        bool armed = false;      // 内核中是否有该请求
+        bool inBatch = false;    // 本轮是否交付过结果，等待调用onBatchEnd
+        int sendSlot = -1;       // 在途的send占用的sends_下标，-1表示没有
+        AcceptCompletionCallback onAccept;
+        RecvCompletionCallback onRecv;
+        CompletionBatchEndCallback onBatchEnd;
+        SendCompletionCallback onSend;
+    };
+
+    /**
+     * @brief 在途的send。owner保证数据在内核完成之前有效，停止后的send也要等到完成事件才释放
+     */
+    struct SendSlot
+    {
+        int fd = -1;
+        std::shared_ptr<void> owner;
+    };
+
+    /**
+     * @brief reap时暂存的完成事件，在dispatchEvents中交付
+     */
+    struct Completion
+    {
+        uint64_t userData;
+        int32_t res;
+        uint32_t flags;
+    };
+
+    IoUringPoller(EventLoop *loop, int ringfd, unsigned entries);
+    bool setupRings(const void *params);
+    bool setupBufferRing();
+
+    Timestamp waitEvents(const struct timespec *timeout, ChannelList *activeChannels);
+    void reapCompletions(ChannelList *activeChannels);
+    void rearmFired();
+
+    FdState &fdState(int fd);
+    io_uring_sqe *getSqe();
+    void submitPending();
+    void armPoll(Channel *channel);
+    void updatePoll(Channel *channel);
+    void cancelPoll(int fd);
+
+    CompletionOp *completionOp(int fd);
+    void armCompletion(int fd, CompletionOp *op);
+    void dispatchCompletions(Timestamp receiveTime);
+    void completeSend(int slot, int32_t res);
+    void recycleBuffer(unsigned bid);
+
+    static uint64_t makeUserData(int fd, uint32_t generation)
+    {
+        return (static_cast<uint64_t>(generation) << 32) | static_cast<uint32_t>(fd);
+    }
+    // 完成模式请求的user_data：最高位标记完成模式，次高位标记accept，第61位标记send(低32位为sends_下标)，
+    // generation只保留29位
+    static const uint64_t kCompletionBit = 1ULL << 63;
+    static const uint64_t kAcceptBit = 1ULL << 62;
+    static const uint64_t kSendBit = 1ULL << 61;
+    static const uint32_t kGenerationMask = (1U << 29) - 1;
+    static uint64_t makeCompletionData(int fd, uint32_t generation, bool accept)
+    {
+        return kCompletionBit | (accept ? kAcceptBit : 0) | makeUserData(fd, generation & kGenerationMask);
+    }
+
+    const int ringfd_;
+    const unsigned entries_;
+
+    // 提交队列(SQ)与完成队列(CQ)的共享内存
+    void *sqRing_;
+    size_t sqRingSize_;
+    void *cqRing_;
+    size_t cqRingSize_;
+    io_uring_sqe *sqes_;
+    size_t sqesSize_;
+
+    unsigned *sqHead_;
+    unsigned *sqTail_;
+    unsigned *sqMask_;
+    unsigned *sqFlags_;
+    unsigned *sqArray_;
+    unsigned *cqHead_;
+    unsigned *cqTail_;
+    unsigned *cqMask_;
+    io_uring_cqe *cqes_;
+
+    unsigned pendingSubmit_;      // 已经写入SQ但还没有提交的请求数
+    std::vector<FdState> fdStates_;
+    std::vector<int> fired_;      // 上一轮触发过、需要重新提交poll的fd
+
+    // 完成模式
+    bool completionMode_;
+    io_uring_buf_ring *bufRing_;  // 与内核共享的provided buffer ring
+    size_t bufRingSize_;
+    char *recvBuffers_;           // kRecvBuffers个kRecvBufferSize字节的接收缓冲区
+    uint16_t bufRingTail_;
+    std::vector<std::unique_ptr<CompletionOp>> ops_;
+    std::vector<Completion> completed_;
+    std::vector<SendSlot> sends_;
+    std::vector<int> freeSends_;  // sends_中空闲的下标
+};
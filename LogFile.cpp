@@ -0,0 +1,144 @@
+#include "LogFile.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+AppendFile::AppendFile(const std::string &filename)
+    : fp_(::fopen(filename.c_str(), "ae")), // 'e'表示O_CLOEXEC
+      writtenBytes_(0)
+{
+    if (fp_ == nullptr)
+    {
+        // 日志模块本身不能用LOG_FATAL报告错误
+        fprintf(stderr, "AppendFile: open %s failed: %s\n", filename.c_str(), strerror(errno));
+        abort();
+    }
+    ::setbuffer(fp_, buffer_, sizeof buffer_);
+}
+
+AppendFile::~AppendFile()
+{
+    ::fclose(fp_);
+}
+
+void AppendFile::append(const char *logline, size_t len)
+{
+    size_t written = 0;
+    while (written != len)
+    {
+        size_t n = ::fwrite_unlocked(logline + written, 1, len - written, fp_);
+        if (n == 0)
+        {
+            int err = ferror(fp_);
+            if (err)
+            {
+                fprintf(stderr, "AppendFile::append() failed %s\n", strerror(err));
+            }
+            break;
+        }
+        written += n;
+    }
+    writtenBytes_ += written;
+}
+
+void AppendFile::flush()
+{
+    ::fflush(fp_);
+}
+
+LogFile::LogFile(const std::string &basename, off_t rollSize, int flushInterval, int checkEveryN)
+    : basename_(basename),
+      rollSize_(rollSize),
+      flushInterval_(flushInterval),
+      checkEveryN_(checkEveryN),
+      count_(0),
+      startOfPeriod_(0),
+      lastRoll_(0),
+      lastFlush_(0),
+      rollCount_(0)
+{
+    rollFile();
+}
+
+LogFile::~LogFile() = default;
+
+void LogFile::append(const char *logline, size_t len)
+{
+    file_->append(logline, len);
+
+    if (file_->writtenBytes() > rollSize_)
+    {
+        rollFile();
+    }
+    else if (++count_ >= checkEveryN_)
+    {
+        count_ = 0;
+        time_t now = ::time(nullptr);
+        time_t thisPeriod = now / kRollPerSeconds_ * kRollPerSeconds_;
+        if (thisPeriod != startOfPeriod_)
+        {
+            rollFile();
+        }
+        else if (now - lastFlush_ > flushInterval_)
+        {
+            lastFlush_ = now;
+            file_->flush();
+        }
+    }
+}
+
+void LogFile::flush()
+{
+    file_->flush();
+}
+
+/**
+ * @brief 换一个新文件。同一秒内不重复滚动，避免文件名冲突
+ */
+bool LogFile::rollFile()
+{
+    time_t now = 0;
+    std::string filename = getLogFileName(basename_, &now);
+    if (now > lastRoll_)
+    {
+        lastRoll_ = now;
+        lastFlush_ = now;
+        startOfPeriod_ = now / kRollPerSeconds_ * kRollPerSeconds_;
+        file_.reset(new AppendFile(filename));
+        ++rollCount_;
+        return true;
+    }
+    return false;
+}
+
+std::string LogFile::getLogFileName(const std::string &basename, time_t *now)
+{
+    std::string filename;
+    filename.reserve(basename.size() + 64);
+    filename = basename;
+
+    char timebuf[32];
+    struct tm tm;
+    *now = ::time(nullptr);
+    localtime_r(now, &tm);
+    strftime(timebuf, sizeof timebuf, ".%Y%m%d-%H%M%S.", &tm);
+    filename += timebuf;
+
+    char hostname[256];
+    if (::gethostname(hostname, sizeof hostname) == 0)
+    {
+        hostname[sizeof hostname - 1] = '\0';
+        filename += hostname;
+    }
+    else
+    {
+        filename += "unknownhost";
+    }
+
+    char pidbuf[32];
+    snprintf(pidbuf, sizeof pidbuf, ".%d", ::getpid());
+    filename += pidbuf;
+    filename += ".log";
+    return filename;
+}
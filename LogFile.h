@@ -0,0 +1,62 @@
+#pragma once
+#include "noncopyable.h"
+
+#include <memory>
+#include <string>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief 只追加写的文件，使用64KB的用户态缓冲和fwrite_unlocked，不是线程安全的
+ */
+class AppendFile : noncopyable
+{
+public:
+    explicit AppendFile(const std::string &filename);
+    ~AppendFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    off_t writtenBytes() const { return writtenBytes_; }
+
+private:
+    FILE *fp_;
+    char buffer_[64 * 1024];
+    off_t writtenBytes_;
+};
+
+/**
+ * @brief 滚动的日志文件。写入的字节数超过rollSize或者跨天时换一个新文件，
+ * 文件名为"basename.年月日-时分秒.主机名.进程号.log"；距上次flush超过flushInterval秒时flush。
+ * 只由异步日志的后端线程使用，不是线程安全的
+ */
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename, off_t rollSize, int flushInterval = 3, int checkEveryN = 1024);
+    ~LogFile();
+
+    void append(const char *logline, size_t len);
+    void flush();
+    bool rollFile();
+    // 已经打开过的文件数，二进制日志据此判断是否需要在新文件开头重写文件头和格式表
+    int64_t rollCount() const { return rollCount_; }
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;
+    const int checkEveryN_; // 每追加多少次检查一次时间，避免每次都调用time()
+
+    int count_;
+    time_t startOfPeriod_; // 当前文件所在的那一天(按UTC对齐)
+    time_t lastRoll_;
+    time_t lastFlush_;
+    int64_t rollCount_;
+    std::unique_ptr<AppendFile> file_;
+
+    static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
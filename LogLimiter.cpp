@@ -0,0 +1,90 @@
+#include "LogLimiter.h"
+
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+    // 精度是一个tick(几毫秒)，通过vDSO读取，比CLOCK_MONOTONIC便宜得多，对按秒计的限速足够
+    int64_t coarseNowMs()
+    {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / (1000 * 1000);
+    }
+}
+
+thread_local LogSuppression *LogSuppression::t_pendingHead_ = nullptr;
+
+bool LogSuppression::report()
+{
+    if (suppressed_ == 0)
+    {
+        return true;
+    }
+    const int64_t now = coarseNowMs();
+    if (lastSummaryMs_ != 0 && now - lastSummaryMs_ < kSummaryIntervalMs)
+    {
+        return false;
+    }
+    lastSummaryMs_ = now;
+    const char *basename = strrchr(file_, '/');
+    Logger::logf(level_, "%s:%d suppressed %llu similar log messages", basename ? basename + 1 : file_, line_,
+                 static_cast<unsigned long long>(suppressed_));
+    suppressed_ = 0;
+    return true;
+}
+
+void LogSuppression::addPending()
+{
+    pending_ = true;
+    nextPending_ = t_pendingHead_;
+    t_pendingHead_ = this;
+}
+
+bool LogSuppression::flushPending()
+{
+    LogSuppression **link = &t_pendingHead_;
+    while (*link != nullptr)
+    {
+        LogSuppression *site = *link;
+        if (site->report())
+        {
+            *link = site->nextPending_;
+            site->nextPending_ = nullptr;
+            site->pending_ = false;
+        }
+        else
+        {
+            link = &site->nextPending_;
+        }
+    }
+    return t_pendingHead_ != nullptr;
+}
+
+bool LogRateLimiter::refill(double perSecond)
+{
+    const double burst = perSecond > 1 ? perSecond : 1;
+    const int64_t now = coarseNowMs();
+    if (lastRefillMs_ == 0)
+    {
+        tokens_ = burst;
+    }
+    else
+    {
+        tokens_ += (now - lastRefillMs_) * perSecond / 1000;
+        if (tokens_ > burst)
+        {
+            tokens_ = burst;
+        }
+    }
+    lastRefillMs_ = now;
+
+    if (tokens_ >= 1)
+    {
+        tokens_ -= 1;
+        return true;
+    }
+    suppress();
+    return false;
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "Logger.h"
+
+#include <stdint.h>
+
+/*
+按调用处限制日志的频率，故障时(后端宕机、fd耗尽)同一行日志不会每秒刷几千次，拖慢本来就有问题的loop：
+  LOG_ERROR_EVERY_N(100, "accept err:%d", errno);          // 每100次输出1次
+  LOG_ERROR_RATELIMIT(5, "connect %s failed", addr);       // 令牌桶，每秒最多5次，允许5次的突发
+每个调用处在每个线程中有一份线程局部的状态(constexpr构造函数把成员置0，属于常量初始化，访问时不需要检查初始化)：
+采样只是一个计数器的递减和比较；限速在令牌够用时只是一次比较，令牌用完后才读一次CLOCK_MONOTONIC_COARSE补充令牌。
+计数按线程独立，n个loop线程同时出错时最多输出n倍。
+被抑制的条数累计起来，在这个调用处下一次输出日志时补一行"xxx.cpp:123 suppressed N similar log messages"，
+同一个调用处每秒最多一行。之后不再输出的调用处由LogSuppression::flushPending()补报：
+EventLoop在有待报告的计数时安排一个定时器调用它；不在loop中的线程可以自己定期调用
+*/
+
+#define MUDUO_LOG_EVERY_N(level, n, LogmsgFormat, ...)                          \
+    do                                                                          \
+    {                                                                           \
+        if (Logger::enabled(level))                                             \
+        {                                                                       \
+            static thread_local LogSampler muduoLogSampler;                     \
+            if (muduoLogSampler.sample(n))                                      \
+            {                                                                   \
+                Logger::logf(level, LogmsgFormat, ##__VA_ARGS__);               \
+                muduoLogSampler.reportSuppressed(level, __FILE__, __LINE__);    \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+#define MUDUO_LOG_RATELIMIT(level, perSecond, LogmsgFormat, ...)                \
+    do                                                                          \
+    {                                                                           \
+        if (Logger::enabled(level))                                             \
+        {                                                                       \
+            static thread_local LogRateLimiter muduoLogLimiter;                 \
+            if (muduoLogLimiter.acquire(perSecond))                             \
+            {                                                                   \
+                Logger::logf(level, LogmsgFormat, ##__VA_ARGS__);               \
+                muduoLogLimiter.reportSuppressed(level, __FILE__, __LINE__);    \
+            }                                                                   \
+        }                                                                       \
+    } while (0)
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOG_INFO_EVERY_N(n, LogmsgFormat, ...) MUDUO_LOG_EVERY_N(INFO, n, LogmsgFormat, ##__VA_ARGS__)
+#define LOG_INFO_RATELIMIT(perSecond, LogmsgFormat, ...) MUDUO_LOG_RATELIMIT(INFO, perSecond, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO_EVERY_N(n, LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#define LOG_INFO_RATELIMIT(perSecond, LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define LOG_ERROR_EVERY_N(n, LogmsgFormat, ...) MUDUO_LOG_EVERY_N(ERR, n, LogmsgFormat, ##__VA_ARGS__)
+#define LOG_ERROR_RATELIMIT(perSecond, LogmsgFormat, ...) MUDUO_LOG_RATELIMIT(ERR, perSecond, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR_EVERY_N(n, LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#define LOG_ERROR_RATELIMIT(perSecond, LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+/**
+ * @brief 被抑制的日志计数，以及定期输出汇总行。只在所属线程中使用。
+ * 有未报告的计数的调用处挂在线程局部的待报告链表上，由flushPending()补报
+ */
+class LogSuppression
+{
+public:
+    constexpr LogSuppression()
+        : suppressed_(0), lastSummaryMs_(0), level_(0), line_(0), file_(nullptr), nextPending_(nullptr), pending_(false)
+    {
+    }
+
+    /**
+     * @brief 刚输出过一条日志时调用：有被抑制的日志并且距上次汇总超过kSummaryIntervalMs时输出一行汇总。
+     * 第一次抑制之前一定先输出过，这里记下的调用处供flushPending()使用
+     */
+    void reportSuppressed(int level, const char *file, int line)
+    {
+        level_ = level;
+        file_ = file;
+        line_ = line;
+        if (suppressed_ != 0)
+        {
+            report();
+        }
+    }
+
+    /**
+     * @brief 报告当前线程中距上次汇总超过kSummaryIntervalMs的调用处的计数，
+     * 还没到时间的留在链表上。返回之后是否还有待报告的调用处
+     */
+    static bool flushPending();
+    // 当前线程是否有待报告的调用处，只读一个线程局部变量，可以在每次loop迭代中调用
+    static bool hasPending() { return t_pendingHead_ != nullptr; }
+
+    static const int64_t kSummaryIntervalMs = 1000;
+
+protected:
+    // 记一次抑制，第一次时挂到待报告链表上
+    void suppress()
+    {
+        ++suppressed_;
+        if (!pending_)
+        {
+            addPending();
+        }
+    }
+
+private:
+    // 返回是否已经报告(或者没有需要报告的计数)
+    bool report();
+    void addPending();
+
+    uint64_t suppressed_;         // 上次汇总之后被抑制的条数
+    int64_t lastSummaryMs_;       // 上次汇总的时间(CLOCK_MONOTONIC_COARSE的毫秒数)
+    int level_;                   // 最近一次输出的级别和调用处
+    int line_;
+    const char *file_;
+    LogSuppression *nextPending_; // 待报告链表
+    bool pending_;                // 是否在待报告链表上
+
+    static thread_local LogSuppression *t_pendingHead_;
+};
+
+/**
+ * @brief 1/n采样：第1次、第n+1次、第2n+1次……输出
+ */
+class LogSampler : public LogSuppression
+{
+public:
+    constexpr LogSampler() : skip_(0) {}
+
+    bool sample(uint32_t n)
+    {
+        if (skip_ != 0)
+        {
+            --skip_;
+            suppress();
+            return false;
+        }
+        skip_ = n > 0 ? n - 1 : 0;
+        return true;
+    }
+
+private:
+    uint32_t skip_; // 还要跳过的次数
+};
+
+/**
+ * @brief 令牌桶：每秒补充perSecond个令牌，最多积累perSecond个(至少1个)，每输出一条消耗一个
+ */
+class LogRateLimiter : public LogSuppression
+{
+public:
+    constexpr LogRateLimiter() : tokens_(0), lastRefillMs_(0) {}
+
+    bool acquire(double perSecond)
+    {
+        if (tokens_ >= 1)
+        {
+            tokens_ -= 1;
+            return true;
+        }
+        return refill(perSecond);
+    }
+
+private:
+    // 令牌用完时按经过的时间补充，仍然不够时计为抑制
+    bool refill(double perSecond);
+
+    double tokens_;
+    int64_t lastRefillMs_; // 0表示还没有补充过，第一次补满
+};
@@ -0,0 +1,127 @@
+#include "LogRing.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+namespace
+{
+    size_t roundUpPowerOfTwo(size_t n)
+    {
+        size_t size = 4096;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+}
+
+LogRing::LogRing(size_t capacity, int tid)
+    : capacity_(roundUpPowerOfTwo(capacity)),
+      mask_(capacity_ - 1),
+      buffer_(static_cast<char *>(::aligned_alloc(64, capacity_))),
+      tid_(tid),
+      head_(0),
+      cachedTail_(0),
+      dropped_(0),
+      tail_(0),
+      peekedSize_(0),
+      closed_(false)
+{
+}
+
+LogRing::~LogRing()
+{
+    ::free(buffer_);
+}
+
+void *LogRing::operator new(size_t size)
+{
+    // aligned_alloc要求大小是对齐值的整数倍
+    void *p = ::aligned_alloc(alignof(LogRing), (size + alignof(LogRing) - 1) & ~(alignof(LogRing) - 1));
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void LogRing::operator delete(void *p)
+{
+    ::free(p);
+}
+
+bool LogRing::tryPush(int64_t microSecondsSinceEpoch, const char *data, size_t len, uint32_t type)
+{
+    if (len > maxRecordLen())
+    {
+        len = maxRecordLen();
+    }
+    const size_t need = alignedSize(len);
+    uint64_t head = head_.load(std::memory_order_relaxed);
+    const size_t toEnd = capacity_ - (head & mask_);
+    const size_t total = toEnd < need ? toEnd + need : need; // 需要绕回时尾部的空间也被占用
+
+    if (head + total - cachedTail_ > capacity_)
+    {
+        cachedTail_ = tail_.load(std::memory_order_acquire);
+        if (head + total - cachedTail_ > capacity_)
+        {
+            return false;
+        }
+    }
+
+    if (toEnd < need)
+    {
+        headerAt(head)->len = kPadding;
+        head += toEnd;
+    }
+    Header *header = headerAt(head);
+    header->microSecondsSinceEpoch = microSecondsSinceEpoch;
+    header->len = static_cast<uint32_t>(len);
+    header->type = type;
+    memcpy(header + 1, data, len);
+    head_.store(head + need, std::memory_order_release);
+    return true;
+}
+
+bool LogRing::overHalfFull()
+{
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    if (head - cachedTail_ <= capacity_ / 2)
+    {
+        return false;
+    }
+    cachedTail_ = tail_.load(std::memory_order_acquire);
+    return head - cachedTail_ > capacity_ / 2;
+}
+
+bool LogRing::peek(uint64_t limit, Record *record)
+{
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail >= limit)
+    {
+        return false;
+    }
+    Header *header = headerAt(tail);
+    peekedSize_ = 0;
+    if (header->len == kPadding)
+    {
+        peekedSize_ = capacity_ - (tail & mask_);
+        tail += peekedSize_;
+        header = headerAt(tail);
+    }
+    record->microSecondsSinceEpoch = header->microSecondsSinceEpoch;
+    record->data = reinterpret_cast<const char *>(header + 1);
+    record->len = header->len;
+    record->type = header->type;
+    peekedSize_ += alignedSize(header->len);
+    return true;
+}
+
+void LogRing::pop()
+{
+    tail_.store(tail_.load(std::memory_order_relaxed) + peekedSize_, std::memory_order_release);
+    peekedSize_ = 0;
+}
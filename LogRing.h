@@ -0,0 +1,89 @@
+#pragma once
+#include "noncopyable.h"
+
+#include <atomic>
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 单生产者单消费者的无锁日志环形缓冲区，每个写日志的线程一个，由异步日志的后端线程读取。
+ * 一条记录是16字节的头(时间戳、长度和类型)加上日志内容，按16字节对齐；
+ * 尾部放不下一条完整记录时写一个填充头跳到开头，记录在内存中总是连续的。
+ * head_和tail_是单调递增的字节位置，只由生产者/消费者各自写入，用acquire/release同步；
+ * 生产者缓存一份tail_，只有空间看起来不够时才读取消费者的位置，避免缓存行来回传递
+ */
+class LogRing : noncopyable
+{
+public:
+    /**
+     * @brief 一条记录的视图，data在下一次pop之前有效
+     */
+    struct Record
+    {
+        int64_t microSecondsSinceEpoch;
+        const char *data;
+        size_t len;
+        uint32_t type;
+    };
+
+    /**
+     * @param capacity 字节数，向上取整为2的幂
+     * @param tid 写入线程的tid，用于丢弃提示
+     */
+    LogRing(size_t capacity, int tid);
+    ~LogRing();
+
+    // head_/tail_按缓存行对齐，C++17之前全局的operator new只保证16字节对齐，由类自己按64字节分配
+    static void *operator new(size_t size);
+    static void operator delete(void *p);
+
+    // 生产者：放不下时返回false，不阻塞。type由使用者定义，原样交给消费者
+    bool tryPush(int64_t microSecondsSinceEpoch, const char *data, size_t len, uint32_t type = 0);
+    // 生产者：已经使用超过一半，需要唤醒消费者
+    bool overHalfFull();
+    // 一条记录最长的长度，更长的日志会被截断
+    size_t maxRecordLen() const { return capacity_ / 2 - kHeaderSize; }
+
+    // 消费者：取出下一条记录但不移除，limit是之前读到的head()，只读取它之前的记录
+    bool peek(uint64_t limit, Record *record);
+    void pop();
+    // 消费者：是否已经读完
+    bool empty() const { return tail_.load(std::memory_order_relaxed) == head(); }
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    // 写入线程退出后由它的线程局部对象标记，后端读完剩余记录后释放
+    void close() { closed_.store(true, std::memory_order_release); }
+    bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+    // 因为放不下而丢弃的记录数，由生产者增加
+    void addDropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    int tid() const { return tid_; }
+
+private:
+    struct Header
+    {
+        int64_t microSecondsSinceEpoch;
+        uint32_t len; // kPadding表示跳到环的开头
+        uint32_t type;
+    };
+    static const size_t kHeaderSize = sizeof(Header);
+    static const uint32_t kPadding = 0xffffffffu;
+
+    static size_t alignedSize(size_t len) { return (kHeaderSize + len + kHeaderSize - 1) & ~(kHeaderSize - 1); }
+    Header *headerAt(uint64_t pos) const { return reinterpret_cast<Header *>(buffer_ + (pos & mask_)); }
+
+    const size_t capacity_;
+    const size_t mask_;
+    char *buffer_;
+    const int tid_;
+
+    alignas(64) std::atomic<uint64_t> head_; // 生产者写入的位置
+    uint64_t cachedTail_;                    // 生产者看到的tail_
+    std::atomic<uint64_t> dropped_;
+    alignas(64) std::atomic<uint64_t> tail_; // 消费者读取的位置
+    uint64_t peekedSize_;                    // peek到的记录(包括前面的填充)占用的字节数
+    std::atomic_bool closed_;
+};
@@ -0,0 +1,251 @@
+#include "LogStream.h"
+#include "Buffer.h"
+#include "InetAddr.h"
+#include "Timestamp.h"
+#include "TimestampFormatter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+    const char kDigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    const char kHexDigits[] = "0123456789abcdef";
+
+    const uint64_t kPowersOf10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+                                    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+                                    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+                                    100000000000000ULL, 1000000000000000ULL};
+
+    /**
+     * @brief 从后往前每次写两位，除法次数减半
+     */
+    size_t convertUnsigned(char *buf, unsigned long long value)
+    {
+        char tmp[24];
+        char *p = tmp + sizeof tmp;
+        while (value >= 100)
+        {
+            const unsigned idx = static_cast<unsigned>(value % 100) * 2;
+            value /= 100;
+            p -= 2;
+            memcpy(p, kDigitPairs + idx, 2);
+        }
+        if (value >= 10)
+        {
+            p -= 2;
+            memcpy(p, kDigitPairs + value * 2, 2);
+        }
+        else
+        {
+            *--p = static_cast<char>('0' + value);
+        }
+        const size_t len = tmp + sizeof tmp - p;
+        memcpy(buf, p, len);
+        return len;
+    }
+
+    int countDigits(uint64_t value)
+    {
+        int digits = 1;
+        while (value >= 10)
+        {
+            value /= 10;
+            ++digits;
+        }
+        return digits;
+    }
+}
+
+size_t LogStream::convert(char *buf, long long value)
+{
+    if (value < 0)
+    {
+        buf[0] = '-';
+        // 取反之前先转成无符号数，LLONG_MIN也不会溢出
+        return 1 + convertUnsigned(buf + 1, 0ULL - static_cast<unsigned long long>(value));
+    }
+    return convertUnsigned(buf, static_cast<unsigned long long>(value));
+}
+
+size_t LogStream::convert(char *buf, unsigned long long value)
+{
+    return convertUnsigned(buf, value);
+}
+
+size_t LogStream::convertHex(char *buf, uint64_t value)
+{
+    char tmp[16];
+    char *p = tmp + sizeof tmp;
+    do
+    {
+        *--p = kHexDigits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    buf[0] = '0';
+    buf[1] = 'x';
+    const size_t len = tmp + sizeof tmp - p;
+    memcpy(buf + 2, p, len);
+    return len + 2;
+}
+
+/**
+ * @brief 精确地把magnitude * scale舍入为整数，与snprintf一样按乘积的真实值舍入，恰好是.5时取偶数。
+ * magnitude * scale + 0.5再截断会舍入两次：乘积先被舍入成double，例如844220926914.49996会变成
+ * 844220926914.5，再加0.5就进位了。fma得到乘积的舍入误差lo(精确值为hi + lo)，
+ * hi < 2^53时小数部分r = hi - floor(hi)是精确的，且r - 0.5不为0时绝对值不小于hi的ulp，而|lo|不超过半个ulp，
+ * 所以只有r恰好为0.5时才需要看lo的符号
+ */
+static uint64_t roundScaled(double magnitude, double scale)
+{
+    const double hi = magnitude * scale;
+    const double lo = ::fma(magnitude, scale, -hi);
+    const double integral = floor(hi);
+    const double r = hi - integral;
+    uint64_t result = static_cast<uint64_t>(integral);
+    if (r > 0.5 || (r == 0.5 && (lo > 0 || (lo == 0 && (result & 1)))))
+    {
+        ++result;
+    }
+    return result;
+}
+
+/**
+ * @brief 1e-4 <= |value| < 1e9时手写定点格式：保留12位有效数字，去掉末尾的0，与"%.12g"的结果一致。
+ * 其它情况(很大、很小、NaN、Inf)交给snprintf("%.12g")
+ */
+size_t LogStream::convertDouble(char *buf, double value)
+{
+    if (value == 0)
+    {
+        buf[0] = '0';
+        return 1;
+    }
+    const double magnitude = fabs(value);
+    if (!(magnitude >= 1e-4 && magnitude < 1e9))
+    {
+        int n = snprintf(buf, kMaxNumericSize, "%.12g", value);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+    // 小数位数：整数部分之外的有效数字，小于1时再加上小数点后的前导0
+    int fracDigits;
+    if (magnitude >= 1)
+    {
+        fracDigits = 12 - countDigits(static_cast<uint64_t>(magnitude));
+    }
+    else
+    {
+        fracDigits = 12;
+        for (double bound = 0.1; magnitude < bound; bound /= 10)
+        {
+            ++fracDigits;
+        }
+    }
+    const uint64_t scale = kPowersOf10[fracDigits];
+    const uint64_t scaled = roundScaled(magnitude, static_cast<double>(scale));
+    uint64_t frac = scaled % scale;
+
+    size_t len = 0;
+    if (value < 0)
+    {
+        buf[len++] = '-';
+    }
+    len += convertUnsigned(buf + len, scaled / scale);
+    if (frac != 0)
+    {
+        int digits = fracDigits;
+        while (frac % 10 == 0)
+        {
+            frac /= 10;
+            --digits;
+        }
+        buf[len++] = '.';
+        // 小数部分的前导0
+        for (int i = countDigits(frac); i < digits; ++i)
+        {
+            buf[len++] = '0';
+        }
+        len += convertUnsigned(buf + len, frac);
+    }
+    return len;
+}
+
+LogStream &LogStream::operator<<(double v)
+{
+    if (static_cast<size_t>(buffer_.avail()) >= kReserved + kMaxNumericSize)
+    {
+        buffer_.add(convertDouble(buffer_.current(), v));
+        return *this;
+    }
+    char buf[kMaxNumericSize];
+    return append(buf, convertDouble(buf, v));
+}
+
+LogStream &LogStream::operator<<(const void *p)
+{
+    char buf[kMaxNumericSize];
+    return append(buf, convertHex(buf, reinterpret_cast<uintptr_t>(p)));
+}
+
+LogStream &LogStream::operator<<(LogHex hex)
+{
+    char buf[kMaxNumericSize];
+    return append(buf, convertHex(buf, hex.value));
+}
+
+LogStream &LogStream::operator<<(const Timestamp &timestamp)
+{
+    char buf[TimestampFormatter::kMaxLen];
+    return append(buf, TimestampFormatter::format(timestamp, TimestampFormatter::kSlash, true, buf));
+}
+
+LogStream &LogStream::operator<<(const InetAddr &addr)
+{
+    char buf[InetAddr::kMaxIpPortLen];
+    return append(buf, addr.toIpPort(buf));
+}
+
+LogStream &LogStream::operator<<(const Buffer &buf)
+{
+    return append(buf.peek(), buf.readableBytes());
+}
+
+void LogStream::finishLine()
+{
+    if (truncated_)
+    {
+        buffer_.append(Logger::kTruncatedMark, strlen(Logger::kTruncatedMark));
+    }
+    buffer_.append("\n", 1);
+}
+
+LogLine::LogLine(int level)
+    : level_(level)
+{
+    char header[Logger::kMaxHeaderLen];
+    stream_.append(header, Logger::formatHeader(level, header));
+}
+
+LogLine::~LogLine()
+{
+    stream_.finishLine();
+    const LogStream::LogBuffer &buf = stream_.buffer();
+    Logger::output(level_, buf.data(), buf.length());
+    if (level_ == FATAL)
+    {
+        exit(-1);
+    }
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include "noncopyable.h"
+#include "FixedBuffer.h"
+#include "Logger.h"
+
+#include <string>
+#include <stddef.h>
+#include <stdint.h>
+
+class Buffer;
+class InetAddr;
+class Timestamp;
+
+/*
+流式日志：LOGS_INFO << "conn " << name << " recv " << n << " bytes from " << peerAddr;
+一行日志在栈上的定长缓冲区(kSmallBuffer)中拼好，整数、十六进制和常见范围的浮点数都是手写的转换，不调用snprintf；
+Timestamp、InetAddr、Buffer直接写入缓冲区，不生成临时的std::string。
+超出缓冲区的部分被截断，行尾加上"...(truncated)"，不会悄悄丢掉。
+级别过滤与LOG_*相同：运行期低于Logger::logLevel()时不求值后面的参数，编译期被MUDUO_MIN_LOG_LEVEL去掉的级别也不求值
+*/
+
+// 运行期过滤：if-else的写法让宏后面可以接<<，也不会与外层的else错配
+#define MUDUO_LOGS_IF(level) \
+    if (!Logger::enabled(level)) \
+    {                            \
+    }                            \
+    else                         \
+        LogLine(level).stream()
+
+// 编译期去掉：参数仍然要能通过编译，但永远不会执行
+#define MUDUO_LOGS_DISABLED() \
+    while (false)             \
+    LogLine(DEBUG).stream()
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOGS_INFO MUDUO_LOGS_IF(INFO)
+#else
+#define LOGS_INFO MUDUO_LOGS_DISABLED()
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define LOGS_ERROR MUDUO_LOGS_IF(ERR)
+#else
+#define LOGS_ERROR MUDUO_LOGS_DISABLED()
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+#define LOGS_DEBUG MUDUO_LOGS_IF(DEBUG)
+#else
+#define LOGS_DEBUG MUDUO_LOGS_DISABLED()
+#endif
+
+// 与LOG_FATAL一样总是输出，这一行写完后退出进程
+#define LOGS_FATAL LogLine(FATAL).stream()
+
+/**
+ * @brief 一段不以'\0'结尾的字节，例如Buffer中的一部分：LOGS_INFO << LogSlice(buf.peek(), 16)
+ */
+struct LogSlice
+{
+    LogSlice(const char *data, size_t len) : data(data), len(len) {}
+    const char *data;
+    size_t len;
+};
+
+/**
+ * @brief 整数按十六进制输出，带"0x"前缀：LOGS_INFO << LogHex(events)
+ */
+struct LogHex
+{
+    explicit LogHex(uint64_t value) : value(value) {}
+    uint64_t value;
+};
+
+/**
+ * @brief 在定长缓冲区上格式化的输出流，空间不够时截断并记下
+ */
+class LogStream : noncopyable
+{
+public:
+    using LogBuffer = FixedBuffer<kSmallBuffer>;
+
+    static const int kMaxNumericSize = 48;
+
+    LogStream() : truncated_(false) {}
+
+    LogStream &operator<<(bool v) { return v ? append("true", 4) : append("false", 5); }
+    LogStream &operator<<(short v) { return formatInteger(static_cast<long long>(v)); }
+    LogStream &operator<<(unsigned short v) { return formatInteger(static_cast<unsigned long long>(v)); }
+    LogStream &operator<<(int v) { return formatInteger(static_cast<long long>(v)); }
+    LogStream &operator<<(unsigned int v) { return formatInteger(static_cast<unsigned long long>(v)); }
+    LogStream &operator<<(long v) { return formatInteger(static_cast<long long>(v)); }
+    LogStream &operator<<(unsigned long v) { return formatInteger(static_cast<unsigned long long>(v)); }
+    LogStream &operator<<(long long v) { return formatInteger(v); }
+    LogStream &operator<<(unsigned long long v) { return formatInteger(v); }
+
+    LogStream &operator<<(float v) { return *this << static_cast<double>(v); }
+    LogStream &operator<<(double v);
+
+    LogStream &operator<<(char v) { return append(&v, 1); }
+    LogStream &operator<<(const char *str) { return str ? append(str, strlen(str)) : append("(null)", 6); }
+    LogStream &operator<<(const unsigned char *str) { return *this << reinterpret_cast<const char *>(str); }
+    LogStream &operator<<(const std::string &str) { return append(str.data(), str.size()); }
+    LogStream &operator<<(const void *p);
+
+    LogStream &operator<<(LogSlice slice) { return append(slice.data, slice.len); }
+    LogStream &operator<<(LogHex hex);
+    LogStream &operator<<(const Timestamp &timestamp); // "2026/10/19 17:13:32.123456"
+    LogStream &operator<<(const InetAddr &addr);       // "ip:port"
+    LogStream &operator<<(const Buffer &buf);          // 可读部分的全部字节
+
+    /**
+     * @brief 追加len字节，放不下时只追加放得下的部分并记为截断
+     */
+    LogStream &append(const char *data, size_t len)
+    {
+        const size_t avail = static_cast<size_t>(buffer_.avail()) - kReserved;
+        if (len > avail)
+        {
+            len = avail;
+            truncated_ = true;
+        }
+        memcpy(buffer_.current(), data, len);
+        buffer_.add(len);
+        return *this;
+    }
+
+    const LogBuffer &buffer() const { return buffer_; }
+    bool truncated() const { return truncated_; }
+    void resetBuffer()
+    {
+        buffer_.reset();
+        truncated_ = false;
+    }
+
+    /**
+     * @brief 结束一行：截断时加上提示，再加换行。之后buffer()是完整的一行
+     */
+    void finishLine();
+
+    // 转换函数，返回写入的长度，buf至少kMaxNumericSize字节。不以'\0'结尾
+    static size_t convert(char *buf, long long value);
+    static size_t convert(char *buf, unsigned long long value);
+    static size_t convertHex(char *buf, uint64_t value);
+    static size_t convertDouble(char *buf, double value);
+
+private:
+    // 留给截断提示和换行，append永远不会用到
+    static const size_t kReserved = 32;
+
+    template <typename T>
+    LogStream &formatInteger(T v)
+    {
+        if (static_cast<size_t>(buffer_.avail()) >= kReserved + kMaxNumericSize)
+        {
+            buffer_.add(convert(buffer_.current(), v));
+            return *this;
+        }
+        char buf[kMaxNumericSize];
+        return append(buf, convert(buf, v));
+    }
+
+    LogBuffer buffer_;
+    bool truncated_;
+};
+
+/**
+ * @brief LOGS_*宏使用的一行日志：构造时写入"[级别]时间 : "，析构时整行交给Logger的输出函数。
+ * FATAL级别的日志写完后退出进程
+ */
+class LogLine : noncopyable
+{
+public:
+    explicit LogLine(int level);
+    ~LogLine();
+
+    LogStream &stream() { return stream_; }
+
+private:
+    const int level_;
+    LogStream stream_;
+};
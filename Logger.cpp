@@ -1,39 +1,128 @@
 #include "Logger.h"
-#include <iostream>
+#include "TimestampFormatter.h"
+#include "FlightRecorder.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
 
-Logger &Logger::instanceLogger()
+namespace
 {
-    static Logger logger;
-    return logger;
+    void defaultOutput(int, const char *msg, size_t len)
+    {
+        fwrite(msg, 1, len, stdout);
+    }
+
+    void defaultFlush()
+    {
+        fflush(stdout);
+    }
+
+    // 与BinaryLog的输出函数一样用原子变量，可以在其它线程写日志时替换
+    std::atomic<Logger::OutputFunc> g_output(defaultOutput);
+    std::atomic<Logger::FlushFunc> g_flush(defaultFlush);
 }
 
-void Logger::setLogLever(int level)
+// 运行期级别的初始值与编译期的下限一致：定义了MUDEBUG时LOG_DEBUG默认就会输出
+std::atomic<int> Logger::s_logLevel_(MUDUO_MIN_LOG_LEVEL);
+constexpr const char *Logger::kTruncatedMark;
+
+void Logger::setOutput(OutputFunc out)
 {
-    LogLevel_ = level;
+    g_output.store(out ? out : defaultOutput, std::memory_order_release);
 }
 
-/**
- * @todo 日志重定向到文件
- * @brief 日志输出、默认输出到stdin。
- */
-void Logger::log(std::string msg)
+void Logger::setFlush(FlushFunc flush)
 {
-    switch (LogLevel_)
+    g_flush.store(flush ? flush : defaultFlush, std::memory_order_release);
+}
+
+void Logger::flush()
+{
+    g_flush.load(std::memory_order_acquire)();
+}
+
+const char *Logger::levelTag(int level)
+{
+    switch (level)
     {
     case LogLevel::INFO:
-        printf("[INFO]");
-        break;
+        return "[INFO]";
     case ERR:
-        printf("[ERROR]");
-        break;
+        return "[ERROR]";
     case FATAL:
-        printf("[FATAL]");
-        break;
+        return "[FATAL]";
     case DEBUG:
-        printf("[DEBUG]");
-        break;
+        return "[DEBUG]";
     default:
-        break;
+        return "";
+    }
+}
+
+namespace
+{
+    const size_t kMaxMessageLen = 1024;
+}
+
+size_t Logger::formatHeader(int level, char *buf)
+{
+    const char *tag = levelTag(level);
+    size_t len = strlen(tag);
+    memcpy(buf, tag, len);
+    len += TimestampFormatter::format(Timestamp::now(), TimestampFormatter::kSlash, false, buf + len);
+    memcpy(buf + len, " : ", 3);
+    return len + 3;
+}
+
+/**
+ * @brief 默认输出到stdout，使用AsyncLogging时由后端线程写入滚动的日志文件
+ */
+void Logger::output(int level, const char *line, size_t len)
+{
+    g_output.load(std::memory_order_acquire)(level, line, len);
+    if (level == FATAL)
+    {
+        Logger::flush(); // 进程马上退出，保证这条日志已经写出去
+        FlightRecorder::dump(STDERR_FILENO);
     }
-    printf("%s : %s\n", Timestamp::now().toString().c_str(), msg.c_str());
+}
+
+/**
+ * @brief 消息直接格式化到时间戳后面，不经过中间缓冲区。
+ * 消息最长kMaxMessageLen字节，超出时截断并在末尾写上kTruncatedMark
+ */
+void Logger::logf(int level, const char *fmt, ...)
+{
+    char line[kMaxHeaderLen + kMaxMessageLen + 1];
+    size_t len = formatHeader(level, line);
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line + len, kMaxMessageLen, fmt, args);
+    va_end(args);
+    if (n > 0)
+    {
+        if (static_cast<size_t>(n) >= kMaxMessageLen)
+        {
+            const size_t markLen = strlen(kTruncatedMark);
+            len += kMaxMessageLen - 1;
+            memcpy(line + len - markLen, kTruncatedMark, markLen);
+        }
+        else
+        {
+            len += n;
+        }
+    }
+    line[len++] = '\n';
+    output(level, line, len);
+}
+
+void Logger::log(int level, const char *msg)
+{
+    char line[kMaxHeaderLen + kMaxMessageLen + 1];
+    size_t len = formatHeader(level, line);
+    size_t msgLen = strnlen(msg, kMaxMessageLen - 1);
+    memcpy(line + len, msg, msgLen);
+    len += msgLen;
+    line[len++] = '\n';
+    output(level, line, len);
 }
@@ -1,97 +1,149 @@
 #pragma once
 #include "noncopyable.h"
+#include <atomic>
 #include <string>
+#include <stdlib.h>
 #include "Timestamp.h"
 
 /*
 日志模块采用宏函数的方式，方便调用
 do-while(0)的作用是为了防止宏函数在使用时出现问题--->宏函数的使用时机是在编译时期，而不是运行时期
+
+日志级别作为参数传给Logger::logf，不修改共享状态。过滤分两层：
+1. 编译期：低于MUDUO_MIN_LOG_LEVEL的宏展开为空语句，参数不会被求值。
+   默认定义了MUDEBUG时为0(DEBUG)，否则为1(INFO)，可以用-DMUDUO_MIN_LOG_LEVEL=2只保留ERROR和FATAL
+2. 运行期：低于Logger::setLogLevel设置的级别时只有一次原子读取和一次分支，不做任何格式化。
+   初始级别同样是MUDUO_MIN_LOG_LEVEL，所以库和调用者要用相同的MUDEBUG/MUDUO_MIN_LOG_LEVEL编译
+LOG_FATAL不会被过滤掉，总是写日志并退出进程
 */
-// LOG_INFO("%s %d ",arg1,arg2)
-#define LOG_INFO(LogmsgFormat, ...)                       \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instanceLogger();        \
-        logger.setLogLever(INFO);                         \
-        char buf[1024];                                   \
-        snprintf(buf, 1024, LogmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+
+// 数值与LogLevel一致，供预处理器比较
+#define MUDUO_LOG_LEVEL_DEBUG 0
+#define MUDUO_LOG_LEVEL_INFO 1
+#define MUDUO_LOG_LEVEL_ERROR 2
+#define MUDUO_LOG_LEVEL_FATAL 3
+
+#ifndef MUDUO_MIN_LOG_LEVEL
+#ifdef MUDEBUG
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_DEBUG
+#else
+#define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_INFO
+#endif
+#endif
+
+#define MUDUO_LOG_IF(level, LogmsgFormat, ...)                       \
+    do                                                               \
+    {                                                                \
+        if (Logger::enabled(level))                                  \
+        {                                                            \
+            Logger::logf(level, LogmsgFormat, ##__VA_ARGS__);        \
+        }                                                            \
     } while (0)
 
-// LOG_INFO("%s %d ",arg1,arg2)
-#define LOG_ERROR(LogmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instanceLogger();        \
-        logger.setLogLever(ERR);                          \
-        char buf[1024];                                   \
-        snprintf(buf, 1024, LogmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
+#define MUDUO_LOG_DISABLED() \
+    do                       \
+    {                        \
     } while (0)
 
 // LOG_INFO("%s %d ",arg1,arg2)
-#define LOG_FATAL(LogmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instanceLogger();        \
-        logger.setLogLever(FATAL);                        \
-        char buf[1024];                                   \
-        snprintf(buf, 1024, LogmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-        exit(-1);                                         \
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOG_INFO(LogmsgFormat, ...) MUDUO_LOG_IF(INFO, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_INFO(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+// LOG_ERROR("%s %d ",arg1,arg2)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+#define LOG_ERROR(LogmsgFormat, ...) MUDUO_LOG_IF(ERR, LogmsgFormat, ##__VA_ARGS__)
+#else
+#define LOG_ERROR(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
+#endif
+
+// LOG_FATAL("%s %d ",arg1,arg2)
+#define LOG_FATAL(LogmsgFormat, ...)                        \
+    do                                                      \
+    {                                                       \
+        Logger::logf(FATAL, LogmsgFormat, ##__VA_ARGS__);   \
+        exit(-1);                                           \
     } while (0)
 
 /**
- * 条件编译，如果定义了MUDEBUG，则打印调试信息
+ * 条件编译，定义了MUDEBUG或者MUDUO_MIN_LOG_LEVEL为0时才打印调试信息
  */
-#ifdef MUDEBUG
-#define LOG_DEBUG(LogmsgFormat, ...)                      \
-    do                                                    \
-    {                                                     \
-        Logger &logger = Logger::instanceLogger();        \
-        logger.setLogLever(DEBUG);                        \
-        char buf[1024];                                   \
-        snprintf(buf, 1024, LogmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf);                                  \
-    } while (0)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(LogmsgFormat, ...) MUDUO_LOG_IF(DEBUG, LogmsgFormat, ##__VA_ARGS__)
 #else
-#define LOG_DEBUG(LogmsgFormat, ...)
+#define LOG_DEBUG(LogmsgFormat, ...) MUDUO_LOG_DISABLED()
 #endif
 
-// 日志级别
+// 日志级别，按严重程度从低到高排列
 enum LogLevel
 {
-    INFO,  // 普通信息
-    ERR,   // 错误信息
-    FATAL, // core信息
-    DEBUG, // 调试信息
+    DEBUG = MUDUO_LOG_LEVEL_DEBUG, // 调试信息
+    INFO = MUDUO_LOG_LEVEL_INFO,   // 普通信息
+    ERR = MUDUO_LOG_LEVEL_ERROR,   // 错误信息
+    FATAL = MUDUO_LOG_LEVEL_FATAL, // core信息
 };
 
 /**
- * @brief 日志工具类
+ * @brief 日志工具类，只有静态成员
 
 */
 class Logger : noncopyable
 {
-private:
-    Logger() : LogLevel_(INFO) {}
-
 public:
+    // 日志的输出函数，参数是级别和一整行日志(包括换行)；flush函数要等到之前输出的日志全部落盘才返回
+    using OutputFunc = void (*)(int level, const char *msg, size_t len);
+    using FlushFunc = void (*)();
+
+    /**
+     * @brief 设置输出和flush函数，nullptr表示恢复默认的stdout。可以在任意线程设置，
+     * 正在调用旧函数的线程仍可能执行完旧函数，旧函数要自己处理这种情况，见AsyncLogging::~AsyncLogging
+     */
+    static void setOutput(OutputFunc out);
+    static void setFlush(FlushFunc flush);
+    // 调用flush函数
+    static void flush();
+
+    /**
+     * @brief 设置运行期的最低日志级别，默认为MUDUO_MIN_LOG_LEVEL(定义了MUDEBUG时为DEBUG，否则为INFO)。
+     * 可以在任意线程调用
+     */
+    static void setLogLevel(LogLevel level) { s_logLevel_.store(level, std::memory_order_relaxed); }
+    static LogLevel logLevel() { return static_cast<LogLevel>(s_logLevel_.load(std::memory_order_relaxed)); }
+
     /**
-     * @brief 单例设计模式、返回日志唯一的实例对象
+     * @brief level级别的日志是否会输出，宏在格式化之前调用
      */
-    static Logger &instanceLogger();
+    static bool enabled(int level) { return level >= s_logLevel_.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief 格式化并写一条日志。FATAL级别的日志会等待flush完成
+     */
+    static void logf(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    /**
+     * @brief 写一条已经格式化好的日志
+     */
+    static void log(int level, const char *msg);
+
+    // 级别的标签，如"[INFO]"
+    static const char *levelTag(int level);
+
+    static const size_t kMaxHeaderLen = 48;
+    // 截断的日志末尾的提示
+    static constexpr const char *kTruncatedMark = "...(truncated)";
 
     /**
-     * @brief 设置日志级别
+     * @brief 写入"[级别]时间 : "，返回长度。buf至少kMaxHeaderLen字节
      */
-    void setLogLever(int level);
+    static size_t formatHeader(int level, char *buf);
 
     /**
-     * @brief 写日志
+     * @brief 把一整行(包括换行)交给输出函数，FATAL级别的日志会等待flush完成
      */
-    void log(std::string msg);
+    static void output(int level, const char *line, size_t len);
 
 private:
-    int LogLevel_;
+    static std::atomic<int> s_logLevel_;
 };
@@ -0,0 +1,95 @@
+#include "LoopHeartbeat.h"
+
+#include <string.h>
+#include <time.h>
+
+LoopHeartbeat::LoopHeartbeat(pid_t tid)
+    : tid_(tid),
+      enabled_(false),
+      seq_(0),
+      iteration_(0),
+      startUs_(0),
+      fd_(-1),
+      kind_(kIdle)
+{
+    name_[0] = '\0';
+}
+
+/**
+ * @brief 记录当前回调的信息。只会在loop线程中被调用
+ */
+void LoopHeartbeat::record(Kind kind, int fd, const char *name, size_t len)
+{
+    // seqlock写端：seq_变为奇数->写数据->seq_变为偶数
+    uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    if (len >= kMaxNameLen)
+    {
+        len = kMaxNameLen - 1;
+    }
+    memcpy(name_, name, len);
+    name_[len] = '\0';
+    fd_.store(fd, std::memory_order_relaxed);
+    startUs_.store(nowUs(), std::memory_order_relaxed);
+    kind_.store(kind, std::memory_order_relaxed);
+
+    seq_.store(seq + 2, std::memory_order_release);
+}
+
+bool LoopHeartbeat::snapshot(Snapshot *out) const
+{
+    // 最多重试几次、loop线程正在频繁写入时直接放弃本轮检查
+    for (int i = 0; i < 4; ++i)
+    {
+        uint32_t before = seq_.load(std::memory_order_acquire);
+        if (before & 1)
+        {
+            continue;
+        }
+        out->iteration = iteration_.load(std::memory_order_relaxed);
+        out->startUs = startUs_.load(std::memory_order_relaxed);
+        out->fd = fd_.load(std::memory_order_relaxed);
+        out->kind = static_cast<Kind>(kind_.load(std::memory_order_relaxed));
+        memcpy(out->name, name_, kMaxNameLen);
+        out->name[kMaxNameLen - 1] = '\0';
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (seq_.load(std::memory_order_relaxed) == before)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *LoopHeartbeat::kindName(Kind kind)
+{
+    switch (kind)
+    {
+    case kIdle:
+        return "idle";
+    case kRead:
+        return "read";
+    case kWrite:
+        return "write";
+    case kClose:
+        return "close";
+    case kError:
+        return "error";
+    case kTimer:
+        return "timer";
+    case kFunctor:
+        return "functor";
+    default:
+        return "unknown";
+    }
+}
+
+int64_t LoopHeartbeat::nowUs()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 + ts.tv_nsec / 1000;
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "noncopyable.h"
+
+#include <atomic>
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @brief EventLoop的心跳信息。由loop线程写入、LoopWatchdog线程读取。
+ * 记录当前迭代次数、当前正在执行的回调的开始时间、所属channel的fd/名字以及回调类型。
+ * 未被LoopWatchdog监视时（enabled_为false），所有记录操作只是一次分支判断。
+ */
+class LoopHeartbeat : noncopyable
+{
+public:
+    // 当前正在执行的回调类型
+    enum Kind
+    {
+        kIdle,    // 没有执行回调（阻塞在poll或者在两个回调之间）
+        kRead,    // Channel读事件回调
+        kWrite,   // Channel写事件回调
+        kClose,   // Channel关闭事件回调
+        kError,   // Channel错误事件回调
+        kTimer,   // 定时器回调
+        kFunctor, // queueInLoop投递的回调
+    };
+
+    static const int kMaxNameLen = 64;
+
+    /**
+     * @brief 某一时刻心跳信息的拷贝，供watchdog线程使用
+     */
+    struct Snapshot
+    {
+        uint64_t iteration; // loop的迭代次数
+        int64_t startUs;    // 当前回调的开始时间（单调时钟，微秒）
+        int fd;             // 当前回调所属channel的fd、-1表示没有
+        Kind kind;          // 当前回调类型
+        char name[kMaxNameLen];
+    };
+
+    explicit LoopHeartbeat(pid_t tid);
+
+    void setEnabled(bool on) { enabled_.store(on, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+    pid_t tid() const { return tid_; }
+
+    /**
+     * @brief loop每次迭代开始时调用
+     */
+    void beginIteration()
+    {
+        if (enabled())
+        {
+            iteration_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief 回调开始执行前调用
+     */
+    void beginHandler(Kind kind, int fd, const std::string &name)
+    {
+        if (enabled())
+        {
+            record(kind, fd, name.c_str(), name.size());
+        }
+    }
+
+    /**
+     * @brief 回调执行完毕后调用
+     */
+    void endHandler()
+    {
+        if (enabled())
+        {
+            kind_.store(kIdle, std::memory_order_release);
+        }
+    }
+
+    /**
+     * @brief 读取一致的心跳快照(seqlock)
+     * @return 读到一致的快照返回true
+     */
+    bool snapshot(Snapshot *out) const;
+
+    static const char *kindName(Kind kind);
+
+    /**
+     * @brief 单调时钟的当前时间、微秒。使用CLOCK_MONOTONIC_COARSE、走vDSO，开销很小
+     */
+    static int64_t nowUs();
+
+private:
+    void record(Kind kind, int fd, const char *name, size_t len);
+
+    const pid_t tid_; // loop所在线程的tid、用于发送信号采集调用栈
+    std::atomic_bool enabled_;
+    std::atomic<uint32_t> seq_; // 奇数表示正在写入
+    std::atomic<uint64_t> iteration_;
+    std::atomic<int64_t> startUs_;
+    std::atomic_int fd_;
+    std::atomic_int kind_;
+    char name_[kMaxNameLen];
+};
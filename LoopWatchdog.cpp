@@ -0,0 +1,231 @@
+#include "LoopWatchdog.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <execinfo.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/**
+ * @brief 采集调用栈的信号处理函数，在卡住的loop线程中执行。
+ * 只使用backtrace/backtrace_symbols_fd/write，不分配内存
+ */
+static void backtraceSignalHandler(int)
+{
+    void *frames[64];
+    int n = ::backtrace(frames, 64);
+    const char header[] = "LoopWatchdog: backtrace of stalled loop thread:\n";
+    ssize_t ret = ::write(STDERR_FILENO, header, sizeof header - 1);
+    (void)ret;
+    ::backtrace_symbols_fd(frames, n, STDERR_FILENO);
+}
+
+LoopWatchdog::LoopWatchdog(double thresholdSeconds, double checkIntervalSeconds)
+    : thresholdUs_(static_cast<int64_t>(thresholdSeconds * 1000 * 1000)),
+      intervalUs_(static_cast<int64_t>(checkIntervalSeconds * 1000 * 1000)),
+      backtraceSignal_(0),
+      stallCallback_(&LoopWatchdog::defaultStallCallback),
+      running_(false),
+      thread_(std::bind(&LoopWatchdog::threadFunc, this), "LoopWatchdog")
+{
+}
+
+LoopWatchdog::~LoopWatchdog()
+{
+    stop();
+    // 被监视的loop不再引用本看门狗。持有registryMutex()，同时析构的loop在detach中等到这里结束之后
+    // 读到的看门狗指针已经是nullptr，不会访问已经析构的看门狗；本看门狗也不会访问已经析构的loop
+    std::lock_guard<std::mutex> registryLock(registryMutex());
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const Watched &w : watched_)
+    {
+        w.loop->heartbeat().setEnabled(false);
+        w.loop->setWatchdog(nullptr);
+    }
+    watched_.clear();
+}
+
+void LoopWatchdog::start()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (running_)
+        {
+            return;
+        }
+        running_ = true;
+    }
+    thread_.start();
+}
+
+void LoopWatchdog::stop()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!running_)
+        {
+            return;
+        }
+        running_ = false;
+    }
+    cond_.notify_one();
+    thread_.join();
+}
+
+std::mutex &LoopWatchdog::registryMutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+
+void LoopWatchdog::detach(EventLoop *loop)
+{
+    std::lock_guard<std::mutex> registryLock(registryMutex());
+    LoopWatchdog *watchdog = loop->watchdog();
+    if (watchdog != nullptr)
+    {
+        watchdog->unwatchLocked(loop);
+    }
+}
+
+void LoopWatchdog::watch(EventLoop *loop)
+{
+    std::lock_guard<std::mutex> registryLock(registryMutex());
+    std::unique_lock<std::mutex> lock(mutex_);
+    Watched w = {loop, 0, 0};
+    watched_.push_back(w);
+    loop->setWatchdog(this);
+    loop->heartbeat().setEnabled(true);
+}
+
+void LoopWatchdog::unwatch(EventLoop *loop)
+{
+    std::lock_guard<std::mutex> registryLock(registryMutex());
+    unwatchLocked(loop);
+}
+
+/**
+ * @brief 调用者持有registryMutex()
+ */
+void LoopWatchdog::unwatchLocked(EventLoop *loop)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = std::find_if(watched_.begin(), watched_.end(),
+                           [loop](const Watched &w)
+                           { return w.loop == loop; });
+    if (it != watched_.end())
+    {
+        loop->heartbeat().setEnabled(false);
+        loop->setWatchdog(nullptr);
+        watched_.erase(it);
+    }
+}
+
+void LoopWatchdog::enableBacktrace(int signo)
+{
+    // 先调用一次backtrace，让libgcc提前加载，信号处理函数中就不会再分配内存
+    void *frame;
+    ::backtrace(&frame, 1);
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = backtraceSignalHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(signo, &sa, nullptr) < 0)
+    {
+        LOG_ERROR("LoopWatchdog::enableBacktrace sigaction error:%d \n", errno);
+        return;
+    }
+    backtraceSignal_ = signo;
+}
+
+/**
+ * @brief 看门狗线程函数、周期性检查所有loop
+ */
+void LoopWatchdog::threadFunc()
+{
+    std::vector<StallInfo> stalls;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_)
+    {
+        cond_.wait_for(lock, std::chrono::microseconds(intervalUs_));
+        if (!running_)
+        {
+            break;
+        }
+        checkAll(&stalls);
+        if (stalls.empty())
+        {
+            continue;
+        }
+        // 回调在锁外执行，回调中调用watch/unwatch不会死锁
+        lock.unlock();
+        if (stallCallback_)
+        {
+            for (const StallInfo &info : stalls)
+            {
+                stallCallback_(info);
+            }
+        }
+        stalls.clear();
+        lock.lock();
+    }
+}
+
+/**
+ * @brief 检查每个loop的心跳，把新发现的卡顿放到stalls中。
+ * 持有mutex_，loop析构时的unwatch会等待本轮检查结束
+ */
+void LoopWatchdog::checkAll(std::vector<StallInfo> *stalls)
+{
+    int64_t now = LoopHeartbeat::nowUs();
+    for (Watched &w : watched_)
+    {
+        LoopHeartbeat::Snapshot snap;
+        if (!w.loop->heartbeat().snapshot(&snap) || snap.kind == LoopHeartbeat::kIdle)
+        {
+            continue;
+        }
+
+        int64_t stalledUs = now - snap.startUs;
+        if (stalledUs < thresholdUs_)
+        {
+            continue;
+        }
+        // 同一次卡顿只上报一次
+        if (w.reportedIteration == snap.iteration && w.reportedStartUs == snap.startUs)
+        {
+            continue;
+        }
+        w.reportedIteration = snap.iteration;
+        w.reportedStartUs = snap.startUs;
+
+        StallInfo info;
+        info.loop = w.loop;
+        info.tid = w.loop->heartbeat().tid();
+        info.fd = snap.fd;
+        info.kind = snap.kind;
+        info.name = snap.name;
+        info.iteration = snap.iteration;
+        info.stalledSeconds = static_cast<double>(stalledUs) / (1000 * 1000);
+        stalls->push_back(info);
+
+        // 信号在锁内发送，此时loop线程一定还在
+        if (backtraceSignal_ != 0)
+        {
+            ::syscall(SYS_tgkill, ::getpid(), info.tid, backtraceSignal_);
+        }
+    }
+}
+
+void LoopWatchdog::defaultStallCallback(const StallInfo &info)
+{
+    LOG_ERROR("LoopWatchdog: loop %p tid=%d stalled %.3fs in %s callback fd=%d name=%s iteration=%lu \n",
+              info.loop, info.tid, info.stalledSeconds, LoopHeartbeat::kindName(info.kind),
+              info.fd, info.name.c_str(), static_cast<unsigned long>(info.iteration));
+}
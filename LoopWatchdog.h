@@ -0,0 +1,99 @@
+#pragma once
+#include "noncopyable.h"
+#include "Thread.h"
+#include "LoopHeartbeat.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+class EventLoop;
+
+/**
+ * @brief loop卡顿看门狗。
+ * 独立线程周期性检查每个被监视EventLoop的心跳，某个回调执行时间超过阈值时上报
+ * 卡住的channel fd、连接名以及回调类型（read/write/timer/functor...）。
+ * 可选地向卡住的线程发送信号、在信号处理函数中把调用栈打印到stderr。
+ */
+class LoopWatchdog : noncopyable
+{
+public:
+    /**
+     * @brief 一次卡顿的描述
+     */
+    struct StallInfo
+    {
+        EventLoop *loop;
+        pid_t tid;              // loop所在线程
+        int fd;                 // 卡住的channel fd、-1表示与channel无关(functor)
+        LoopHeartbeat::Kind kind;
+        std::string name;       // channel名字、TcpConnection的channel即连接名
+        uint64_t iteration;     // 卡住时loop的迭代次数
+        double stalledSeconds;  // 已经卡住的时间
+    };
+    using StallCallback = std::function<void(const StallInfo &)>;
+
+    /**
+     * @param thresholdSeconds 一个回调执行超过该时间即视为卡顿
+     * @param checkIntervalSeconds 看门狗线程的检查周期
+     */
+    explicit LoopWatchdog(double thresholdSeconds = 1.0, double checkIntervalSeconds = 0.1);
+    ~LoopWatchdog();
+
+    void start();
+    void stop();
+
+    /**
+     * @brief 开始/停止监视loop、可以在任意线程调用
+     */
+    void watch(EventLoop *loop);
+    void unwatch(EventLoop *loop);
+
+    /**
+     * @brief loop析构时调用：把loop从监视它的看门狗(如果有)中移除。
+     * 读取loop的看门狗指针和调用unwatch都持有registryMutex()，看门狗析构时同样要先拿到这把锁，
+     * 所以不会在两者之间被析构
+     */
+    static void detach(EventLoop *loop);
+
+    /**
+     * @brief 设置卡顿回调、默认通过LOG_ERROR输出。在看门狗线程中不持有锁执行，需在start之前调用。
+     * StallInfo::loop只用于标识，回调执行时该loop可能已经析构
+     */
+    void setStallCallback(const StallCallback &cb) { stallCallback_ = cb; }
+
+    /**
+     * @brief 卡顿时向卡住的线程发送signo、由信号处理函数把调用栈写到stderr。需在start之前调用
+     * 注意：信号可能打断卡住线程中的阻塞系统调用(EINTR)
+     */
+    void enableBacktrace(int signo);
+
+private:
+    struct Watched
+    {
+        EventLoop *loop;
+        uint64_t reportedIteration; // 已经上报过的卡顿、避免同一次卡顿重复上报
+        int64_t reportedStartUs;
+    };
+
+    // 保护所有loop的看门狗指针(EventLoop::watchdog_)，加锁顺序：先registryMutex()再mutex_
+    static std::mutex &registryMutex();
+    void unwatchLocked(EventLoop *loop);
+
+    void threadFunc();
+    void checkAll(std::vector<StallInfo> *stalls);
+    static void defaultStallCallback(const StallInfo &info);
+
+    const int64_t thresholdUs_;
+    const int64_t intervalUs_;
+    int backtraceSignal_; // 0表示不采集调用栈
+    StallCallback stallCallback_;
+
+    bool running_;
+    Thread thread_;
+    std::mutex mutex_; // 保护watched_以及running_
+    std::condition_variable cond_;
+    std::vector<Watched> watched_;
+};
@@ -0,0 +1,149 @@
+#include "PollPoller.h"
+#include "Logger.h"
+#include "Channel.h"
+#include <errno.h>
+#include <signal.h>
+#include <algorithm>
+#include <cassert>
+
+// channel未添加到poller中
+const int kNew = -1;
+
+PollPoller::PollPoller(EventLoop *loop)
+    : Poller(loop)
+{
+}
+
+PollPoller::~PollPoller() = default;
+
+/**
+ * @brief 开启事件循环，等待事件发生
+ */
+Timestamp PollPoller::poll(int timeoutMs, ChannelList *activeChannels)
+{
+    LOG_INFO("func=%s => fd total count:%lu \n", __FUNCTION__, pollfds_.size());
+    int numEvents = ::poll(pollfds_.data(), pollfds_.size(), timeoutMs);
+    return handlePollResult(numEvents, errno, activeChannels);
+}
+
+/**
+ * @brief 微秒精度的poll，使用ppoll(timespec超时)
+ */
+Timestamp PollPoller::pollPrecise(int64_t timeoutUs, ChannelList *activeChannels)
+{
+    struct timespec ts;
+    struct timespec *timeout = nullptr; // nullptr表示一直阻塞
+    if (timeoutUs >= 0)
+    {
+        ts.tv_sec = static_cast<time_t>(timeoutUs / Timestamp::kMicroSecondsPerSecond);
+        ts.tv_nsec = static_cast<long>((timeoutUs % Timestamp::kMicroSecondsPerSecond) * 1000);
+        timeout = &ts;
+    }
+    int numEvents = ::ppoll(pollfds_.data(), pollfds_.size(), timeout, nullptr);
+    return handlePollResult(numEvents, errno, activeChannels);
+}
+
+/**
+ * @brief 处理poll返回的结果，返回事件发生的时间
+ */
+Timestamp PollPoller::handlePollResult(int numEvents, int saveErrno, ChannelList *activeChannels)
+{
+    Timestamp now(Timestamp::now());
+    if (numEvents > 0)
+    {
+        LOG_INFO("%d events happend \n", numEvents);
+        fillActiveChannels(numEvents, activeChannels);
+    }
+    else if (numEvents == 0)
+    {
+        LOG_DEBUG("%s timeout\n", __FUNCTION__);
+    }
+    else if (saveErrno != EINTR)
+    {
+        errno = saveErrno;
+        LOG_ERROR("PollPoller::poll() err");
+    }
+    return now;
+}
+
+/**
+ * @brief 遍历pollfds_，找出发生事件的channel。poll与epoll的事件宏取值相同，Channel可以直接使用
+ */
+void PollPoller::fillActiveChannels(int numEvents, ChannelList *activeChannels) const
+{
+    for (PollFdList::const_iterator pfd = pollfds_.begin(); pfd != pollfds_.end() && numEvents > 0; ++pfd)
+    {
+        if (pfd->revents > 0)
+        {
+            --numEvents;
+            Channel *channel = findChannel(pfd->fd);
+            if (channel == nullptr)
+            {
+                LOG_ERROR("PollPoller fd=%d has no channel \n", pfd->fd);
+                continue;
+            }
+            channel->setRevents(pfd->revents);
+            activeChannels->push_back(channel);
+        }
+    }
+}
+
+/**
+ * @brief 更新channel管理的fd对应的事件。新channel追加到pollfds_末尾，已有的channel按index_直接修改
+ */
+void PollPoller::updateChannel(Channel *channel)
+{
+    LOG_INFO("func=%s fd=%d events=%d index=%d \n", __FUNCTION__, channel->fd(), channel->events(), channel->index());
+    if (channel->index() < 0)
+    {
+        struct pollfd pfd;
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        pollfds_.push_back(pfd);
+        channel->setIndex(static_cast<int>(pollfds_.size()) - 1);
+        insertChannel(channel);
+        assert(pollfds_.size() == numChannels());
+    }
+    else
+    {
+        struct pollfd &pfd = pollfds_[channel->index()];
+        pfd.fd = channel->fd();
+        pfd.events = static_cast<short>(channel->events());
+        pfd.revents = 0;
+        if (channel->isNoneEvent())
+        {
+            // 不关心任何事件时让poll忽略该fd，-fd-1保证0号fd也能被忽略
+            pfd.fd = -channel->fd() - 1;
+        }
+    }
+}
+
+/**
+ * @brief 从poller中删除Channel：与最后一个元素交换后pop_back，O(1)
+ */
+void PollPoller::removeChannle(Channel *channel)
+{
+    LOG_INFO("func=%s fd=%d ", __FUNCTION__, channel->fd());
+    int idx = channel->index();
+    if (idx < 0)
+    {
+        return;
+    }
+    eraseChannel(channel);
+
+    size_t last = pollfds_.size() - 1;
+    if (static_cast<size_t>(idx) != last)
+    {
+        int lastFd = pollfds_.back().fd;
+        if (lastFd < 0)
+        {
+            lastFd = -lastFd - 1;
+        }
+        std::iter_swap(pollfds_.begin() + idx, pollfds_.end() - 1);
+        findChannel(lastFd)->setIndex(idx);
+    }
+    pollfds_.pop_back();
+    channel->setIndex(kNew);
+    assert(pollfds_.size() == numChannels());
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include "Poller.h"
+#include "Timestamp.h"
+#include <vector>
+#include <poll.h>
+class Channel;
+
+/**
+ * @brief PollPoller继承自Poller、封装的是poll的使用。
+ * channel的index_即为其在pollfds_中的下标，增删改都是O(1)，也没有epoll_ctl的系统调用开销，
+ * 适合只监听少量fd的loop。
+ */
+class PollPoller : public Poller
+{
+public:
+    PollPoller(EventLoop *loop);
+    ~PollPoller() override;
+    Timestamp poll(int timeoutMs, ChannelList *activeChannels) override;
+    Timestamp pollPrecise(int64_t timeoutUs, ChannelList *activeChannels) override;
+    void updateChannel(Channel *channel) override;
+    void removeChannle(Channel *channel) override;
+
+private:
+    using PollFdList = std::vector<struct pollfd>;
+
+    // 处理poll/ppoll的返回值
+    Timestamp handlePollResult(int numEvents, int saveErrno, ChannelList *activeChannels);
+    // 填写活跃连接
+    void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
+
+    PollFdList pollfds_; // 传给poll的数组，下标与channel的index_一致
+};
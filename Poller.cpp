@@ -1,7 +1,17 @@
 #include "Poller.h"
 #include "Channel.h"
+#include "FlightRecorder.h"
 
-Poller::Poller(EventLoop *loop) : ownerLoop_(loop)
+#include <algorithm>
+#include <cassert>
+
+// fd表的初始大小
+const size_t kInitChannelTableSize = 64;
+
+Poller::Poller(EventLoop *loop)
+    : Channels_(kInitChannelTableSize, nullptr),
+      numChannels_(0),
+      ownerLoop_(loop)
 {
 }
 
@@ -10,6 +20,51 @@ Poller::Poller(EventLoop *loop) : ownerLoop_(loop)
  */
 bool Poller::hasChannel(Channel *channel) const
 {
-    auto it = Channels_.find(channel->fd());
-    return it != Channels_.end() && it->second == channel;
+    return findChannel(channel->fd()) == channel;
+}
+
+void Poller::insertChannel(Channel *channel)
+{
+    const size_t fd = static_cast<size_t>(channel->fd());
+    if (fd >= Channels_.size())
+    {
+        Channels_.resize(std::max(fd + 1, Channels_.size() * 2), nullptr);
+    }
+    // 同一个fd同时只能有一个channel
+    assert(Channels_[fd] == nullptr);
+    Channels_[fd] = channel;
+    ++numChannels_;
+}
+
+void Poller::eraseChannel(Channel *channel)
+{
+    const int fd = channel->fd();
+    Channel *registered = findChannel(fd);
+    // 表中登记的必须是同一个channel
+    assert(registered == nullptr || registered == channel);
+    if (registered == channel)
+    {
+        Channels_[fd] = nullptr;
+        --numChannels_;
+    }
+    assert(numChannels_ <= Channels_.size());
+}
+
+void Poller::dispatchEvents(Timestamp receiveTime, ChannelList *activeChannels)
+{
+    FlightRecorder::record(FlightRecorder::kPoll, -1, static_cast<int64_t>(activeChannels->size()));
+    for (Channel *channel : *activeChannels)
+    {
+        // Poller监听哪些channel发生事件了，然后上报给EventLoop，通知channel处理相应的事件
+        channel->handleEvent(receiveTime);
+    }
+}
+
+/**
+ * @brief 向上取整到毫秒，保证不会在截止时间之前醒来
+ */
+Timestamp Poller::pollPrecise(int64_t timeoutUs, ChannelList *activeChannels)
+{
+    int timeoutMs = timeoutUs < 0 ? -1 : static_cast<int>((timeoutUs + 999) / 1000);
+    return poll(timeoutMs, activeChannels);
 }
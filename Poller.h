@@ -1,9 +1,11 @@
 #pragma once
 #include "noncopyable.h"
 #include "Timestamp.h"
+#include "CallBacks.h"
 
 #include <vector>
-#include <unordered_map>
+#include <memory>
+#include <stddef.h>
 
 class Channel;
 class EventLoop;
@@ -15,10 +17,33 @@ class Poller : noncopyable
 {
 public:
     using ChannelList = std::vector<Channel *>;
-    using ChannelMap = std::unordered_map<int, Channel *>; // fd和channel的映射关系
+    using ChannelTable = std::vector<Channel *>; // 以fd为下标的channel表
 
 protected:
-    ChannelMap Channels_; // Poller中的CHannel列表，保存fd和channel的映射关系,用于快速查找fd对应的channel.
+    /**
+     * @brief 把channel登记到以fd为下标的表中，表按需扩容
+     */
+    void insertChannel(Channel *channel);
+
+    /**
+     * @brief 从表中删除channel
+     */
+    void eraseChannel(Channel *channel);
+
+    /**
+     * @brief 查找fd对应的channel，不存在时返回nullptr
+     */
+    Channel *findChannel(int fd) const
+    {
+        return fd >= 0 && static_cast<size_t>(fd) < Channels_.size() ? Channels_[fd] : nullptr;
+    }
+
+    size_t numChannels() const { return numChannels_; }
+
+    // Poller中的Channel列表，fd是内核分配的最小可用整数，比较密集，直接用fd作下标，
+    // 增删查都是O(1)且不需要哈希和节点分配
+    ChannelTable Channels_;
+    size_t numChannels_;
 
 private:
     EventLoop *ownerLoop_; // 定义Poller所属的事件循环类对象
@@ -33,6 +58,35 @@ public:
      */
     virtual Timestamp poll(int timeoutMs, ChannelList *activeChannels) = 0;
 
+    /**
+     * @brief 微秒精度超时的poll，timeoutUs<0表示一直阻塞。
+     * 默认实现向上取整到毫秒后调用poll，支持更高精度的Poller可以重写
+     */
+    virtual Timestamp pollPrecise(int64_t timeoutUs, ChannelList *activeChannels);
+
+    /**
+     * @brief 分发poll返回的活跃事件。默认实现依次调用activeChannels中channel的handleEvent，
+     * Poller可以重写为直接从内核返回的事件数组分发，此时poll不填写activeChannels
+     */
+    virtual void dispatchEvents(Timestamp receiveTime, ChannelList *activeChannels);
+
+    /**
+     * @brief 完成模式(proactor)的可选接口：由Poller代为accept/recv，完成后把结果交给回调，
+     * 不再先通知可读、再由回调发起系统调用。只有以完成模式创建的IoUringPoller支持，
+     * 其它Poller返回false，调用者继续使用channel的可读事件。回调在dispatchEvents中执行
+     */
+    // 在channel的fd上持续accept，每个新连接(或错误)调用一次onAccept，本轮的结果都交付之后调用onBatchEnd
+    virtual bool startAccept(Channel *, AcceptCompletionCallback, CompletionBatchEndCallback) { return false; }
+    // 在channel的fd上持续recv：n>0为收到的数据(只在回调期间有效)，n==0为对端关闭，n<0为错误，
+    // 本轮的数据都交付之后调用onBatchEnd，调用者可以把多次recv的数据合并处理
+    virtual bool startRecv(Channel *, RecvCompletionCallback, CompletionBatchEndCallback) { return false; }
+    // 在startRecv之后登记channel上发送完成的回调
+    virtual bool startSend(Channel *, SendCompletionCallback) { return false; }
+    // 提交一次send，完成后调用onSend。[data, data+len)与owner保持到完成为止，同一个fd同时只能有一个send
+    virtual void submitSend(Channel *, const char *, size_t, const std::shared_ptr<void> &) {}
+    // 停止startAccept/startRecv/submitSend发起的操作，之后不再调用onAccept/onRecv/onSend。removeChannle时自动停止
+    virtual void stopCompletion(Channel *) {}
+
     /**
      * @brief 更新channel管理的fd对应的事件
      */
@@ -0,0 +1,58 @@
+#include "SetTimerQueue.h"
+#include "Timer.h"
+
+#include <stdint.h>
+
+SetTimerQueue::SetTimerQueue(EventLoop *loop, bool useTimerfd)
+    : TimerQueue(loop, useTimerfd)
+{
+}
+
+SetTimerQueue::~SetTimerQueue()
+{
+}
+
+void SetTimerQueue::getExpired(MonotonicTime now, std::vector<Timer *> *expired)
+{
+    // reinterpret_cast<Timer *>(UINTPTR_MAX) 是为了在 timers_ 中找到第一个未到期的定时器
+    // 关于reiterpret_cast的用法，可以参笔记
+    Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX)); // 超时时间和定时器指针
+
+    // 返回第一个未到期的定时器的迭代器
+    TimerList::iterator end = timers_.lower_bound(sentry);
+    for (TimerList::iterator it = timers_.begin(); it != end; ++it)
+    {
+        expired->push_back(it->second); // 将到期的定时器加入到 expired 中
+    }
+
+    // 从 timers_ 中移除到期的定时器
+    timers_.erase(timers_.begin(), end);
+}
+
+/**
+ * 插入定时器
+ * @return 是否最早到期的定时器改变
+ */
+bool SetTimerQueue::insert(Timer *timer)
+{
+    bool earliestChanged = false;         // 是否最早到期的定时器改变
+    MonotonicTime when = timer->expiration(); // 获取定时器到期时间
+    TimerList::iterator it = timers_.begin();
+    // 如果 timers_ 为空或者 when 小于 timers_ 中的第一个定时器的到期时间
+    if (it == timers_.end() || when < it->first)
+    {
+        earliestChanged = true; // 最早到期的定时器改变
+    }
+    timers_.insert(Entry(when, timer)); // 插入定时器
+    return earliestChanged;
+}
+
+bool SetTimerQueue::remove(Timer *timer)
+{
+    return timers_.erase(Entry(timer->expiration(), timer)) > 0; // 从定时器列表中移除定时器
+}
+
+MonotonicTime SetTimerQueue::nextExpiration() const
+{
+    return timers_.empty() ? MonotonicTime::invalid() : timers_.begin()->first;
+}
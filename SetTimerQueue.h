@@ -0,0 +1,28 @@
+#pragma once
+#include "TimerQueue.h"
+
+#include <set>
+#include <vector>
+
+/**
+ * @brief 用std::set存放定时器，按到期时间排序。插入、取消都是O(log n)，每个定时器一次节点分配，到期时间精确到微秒
+ */
+class SetTimerQueue : public TimerQueue
+{
+public:
+    using Entry = std::pair<MonotonicTime, Timer *>; // 到期时间和定时器指针
+    using TimerList = std::set<Entry>;               // 定时器列表
+
+    SetTimerQueue(EventLoop *loop, bool useTimerfd);
+    ~SetTimerQueue() override;
+
+    MonotonicTime nextExpiration() const override;
+
+protected:
+    bool insert(Timer *timer) override;
+    bool remove(Timer *timer) override;
+    void getExpired(MonotonicTime now, std::vector<Timer *> *expired) override;
+
+private:
+    TimerList timers_; // 定时器列表
+};
@@ -0,0 +1,89 @@
+#include "SignalHandler.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/signalfd.h>
+#include <errno.h>
+#include <unistd.h>
+
+/**
+ * 创建一个空信号集的signalfd
+ */
+static int createSignalfd(const sigset_t *mask)
+{
+    int fd = ::signalfd(-1, mask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_FATAL("signalfd error:%d \n", errno);
+    }
+    return fd;
+}
+
+static sigset_t emptySigset()
+{
+    sigset_t mask;
+    sigemptyset(&mask);
+    return mask;
+}
+
+SignalHandler::SignalHandler(EventLoop *loop)
+    : loop_(loop),
+      mask_(emptySigset()),
+      signalfd_(createSignalfd(&mask_)),
+      signalChannel_(loop, signalfd_)
+{
+    signalChannel_.setReadCallBack(std::bind(&SignalHandler::handleRead, this));
+    signalChannel_.setName("signalfd");
+    signalChannel_.enableReading();
+}
+
+SignalHandler::~SignalHandler()
+{
+    signalChannel_.disableAll();
+    signalChannel_.remove();
+    ::close(signalfd_);
+}
+
+void SignalHandler::add(int signo, const SignalCallback &cb)
+{
+    callbacks_[signo] = cb;
+
+    sigaddset(&mask_, signo);
+    // loop线程中也要阻塞该信号，否则信号会按默认方式处理而不会进入signalfd
+    sigset_t block;
+    sigemptyset(&block);
+    sigaddset(&block, signo);
+    ::pthread_sigmask(SIG_BLOCK, &block, nullptr);
+
+    // 传入已有的fd即更新其监听的信号集合
+    if (::signalfd(signalfd_, &mask_, 0) < 0)
+    {
+        LOG_ERROR("SignalHandler::add signalfd signo:%d error:%d \n", signo, errno);
+    }
+}
+
+/**
+ * @brief signalfd可读、读出所有到达的信号并执行回调
+ */
+void SignalHandler::handleRead()
+{
+    struct signalfd_siginfo info;
+    while (true)
+    {
+        ssize_t n = ::read(signalfd_, &info, sizeof info);
+        if (n != sizeof info)
+        {
+            if (n < 0 && errno != EAGAIN)
+            {
+                LOG_ERROR("SignalHandler::handleRead error:%d \n", errno);
+            }
+            break;
+        }
+
+        auto it = callbacks_.find(static_cast<int>(info.ssi_signo));
+        if (it != callbacks_.end() && it->second)
+        {
+            it->second(static_cast<int>(info.ssi_signo));
+        }
+    }
+}
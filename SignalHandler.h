@@ -0,0 +1,36 @@
+#pragma once
+#include "noncopyable.h"
+#include "CallBacks.h"
+#include "Channel.h"
+
+#include <map>
+#include <signal.h>
+
+class EventLoop;
+
+/**
+ * @brief 基于signalfd的信号处理。信号作为普通的读事件交给EventLoop，在loop线程中执行回调，
+ * 回调里可以做任何事情（不受async-signal-safe限制）。
+ * signalfd要求信号在所有线程中都被阻塞，EventLoop::onSignal会阻塞调用线程和loop线程的该信号，
+ * 所以应当在创建其它线程之前注册，之后创建的线程会继承信号掩码。
+ */
+class SignalHandler : noncopyable
+{
+public:
+    explicit SignalHandler(EventLoop *loop);
+    ~SignalHandler();
+
+    /**
+     * @brief 注册signo的回调、只能在loop线程中调用
+     */
+    void add(int signo, const SignalCallback &cb);
+
+private:
+    void handleRead();
+
+    EventLoop *loop_;
+    sigset_t mask_;                         // 当前监听的信号集合
+    const int signalfd_;                    // signalfd文件描述符
+    Channel signalChannel_;                 // signalfd对应的channel
+    std::map<int, SignalCallback> callbacks_; // 信号和回调的映射
+};
@@ -48,14 +48,11 @@ int Socket::accept(InetAddr *peeraddr)
     bzero(&addr, sizeof(addr));
 
     int connfd = ::accept4(sockfd_, (sockaddr *)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    // 失败时不在这里输出日志：backlog取空时的EAGAIN是正常情况，其它错误由调用者限速输出
     if (connfd >= 0)
     {
         peeraddr->setSockaddr(addr);
     }
-    else
-    {
-        LOG_ERROR("accept sockfd:%d fail \n", sockfd_);
-    }
 
     return connfd;
 }
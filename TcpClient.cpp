@@ -39,7 +39,7 @@ TcpClient::~TcpClient()
     // 如果连接存在
     if (conn)
     {
-        CloseCallback cb = std::bind(&removeConnection, this, std::placeholders::_1);
+        CloseCallback cb = std::bind(&TcpClient::removeConnection, this, std::placeholders::_1);
         // 为什么要在IO线程中执行setCloseCallback?
         // 因为TcpConnection的生命周期是在IO线程中管理的、让TcpConnection自己管理自己的生命周期
         loop_->runInLoop(std::bind(&TcpConnection::setCloseCallback, conn, cb));
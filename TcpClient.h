@@ -56,7 +56,7 @@ private:
     newConnection(int sockfd);                           // 新连接处理函数
     void removeConnection(const TcpConnectionPtr &conn); // 移除连接
     void removeConnectionInLoop(EventLoop *loop, const TcpConnectionPtr &conn);
-    void TcpClient::removeConnctor(const ConnectorPtr &connector);
+    void removeConnctor(const ConnectorPtr &connector);
 
 private:
     EventLoop *loop_;        // 事件循环
@@ -2,10 +2,13 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "Logger.h"
+#include "LogLimiter.h"
 #include "EventLoop.h"
 #include "CallBacks.h"
+#include "FlightRecorder.h"
 
 #include <unistd.h>
+#include <netinet/in.h>
 
 /**
  * @brief 默认的连接回调函数
@@ -59,7 +62,10 @@ TcpConnection::TcpConnection(EventLoop *loop,
       socket_(new Socket(sockfd)),
       channel_(new Channel(loop, sockfd)), localAddr_(localAddr),
       peerAddr_(peerAddr),
-      highWaterMark_(64 * 1024 * 1024)
+      highWaterMark_(64 * 1024 * 1024),
+      recvPending_(false),
+      sendCompletion_(false),
+      sending_(false)
 {
     // 给channel设置相应的回调函数
     channel_->setReadCallBack(
@@ -70,6 +76,7 @@ TcpConnection::TcpConnection(EventLoop *loop,
         std::bind(&TcpConnection::handleClose, this));
     channel_->setErrorCallBack(
         std::bind(&TcpConnection::handleError, this));
+    channel_->setName(name_); // 卡顿时LoopWatchdog上报的连接名
 
     LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
     socket_->setKeepAlive(true);
@@ -100,6 +107,50 @@ void TcpConnection::send(const std::string &msg)
     }
 }
 
+/**
+ * @brief 发送[data, data+len)的数据。不在loop线程中调用时会拷贝一份数据
+ */
+void TcpConnection::send(const void *data, size_t len)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(data, len);
+        }
+        else
+        {
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(),
+                                       std::string(static_cast<const char *>(data), len)));
+        }
+    }
+}
+
+/**
+ * @brief 发送buf中的全部可读数据，发送后清空buf
+ */
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // 跨线程时拷贝一份数据、buf在回调执行前可能已经被修改或释放
+            loop_->runInLoop(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), buf->retrieveAllAsString()));
+        }
+    }
+}
+
+void TcpConnection::sendStringInLoop(const std::string &msg)
+{
+    sendInLoop(msg.data(), msg.size());
+}
+
 /**
  * @brief 在自己的线程中关闭连接--写半关闭。
 
@@ -123,10 +174,26 @@ void TcpConnection::connectEstablished()
     setState(kConnected);
     // 初始化tie_、用于观察channel_是否还在
     channel_->tie(shared_from_this());
-    channel_->enableReading(); // 向poller注册channel的epollin事件
+    // io_uring完成模式下由Poller直接recv到provided buffer，否则向poller注册channel的epollin事件
+    if (!loop_->startRecv(channel_.get(),
+                          std::bind(&TcpConnection::handleRecvCompletion, this, std::placeholders::_1,
+                                    std::placeholders::_2, std::placeholders::_3, std::placeholders::_4),
+                          std::bind(&TcpConnection::handleRecvBatchEnd, this)))
+    {
+        channel_->enableReading();
+    }
+    else
+    {
+        sendCompletion_ = loop_->startSend(channel_.get(),
+                                           std::bind(&TcpConnection::handleSendCompletion, this,
+                                                     std::placeholders::_1, std::placeholders::_2));
+    }
+    const sockaddr_in *peer = reinterpret_cast<const sockaddr_in *>(peerAddr_.getSockaddr());
+    FlightRecorder::record(FlightRecorder::kConnUp, channel_->fd(), peer->sin_addr.s_addr, ntohs(peer->sin_port));
 
-    // 新连接建立，执行回调
-    connectionCallback_(shared_from_this());
+    // 新连接建立，执行回调。调用副本：回调中可以替换connectionCallback_(例如CoConnection)
+    ConnectionCallback cb = connectionCallback_;
+    cb(shared_from_this());
 }
 /**
  * @brief 连接销毁
@@ -137,7 +204,9 @@ void TcpConnection::connectDestroyed()
     {
         setState(kDisconnected);
         channel_->disableAll(); // 把channel的所有感兴趣的事件，从poller中del掉
-        connectionCallback_(shared_from_this());
+        FlightRecorder::record(FlightRecorder::kConnDown, channel_->fd(), kConnected);
+        ConnectionCallback cb = connectionCallback_;
+        cb(shared_from_this());
     }
     channel_->remove(); // 把channel从poller中删除掉
 }
@@ -164,6 +233,7 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 {
     int savedErr = 0;
     ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErr);
+    FlightRecorder::record(FlightRecorder::kRead, channel_->fd(), n, savedErr);
     if (n > 0)
     { // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作onMessage
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
@@ -180,6 +250,121 @@ void TcpConnection::handleRead(Timestamp receiveTime)
     }
 }
 
+/**
+ * @brief io_uring完成模式下Poller交付的recv结果，data只在本次调用期间有效。
+ * 每次recv最多一个provided buffer(4KB)，逐次调用messageCallback_会把一个大消息拆成很多次小的回复，
+ * 所以先追加到inputBuffer_，本轮结束时(handleRecvBatchEnd)再调用一次
+ */
+void TcpConnection::handleRecvCompletion(const char *data, ssize_t n, int savedErr, Timestamp receiveTime)
+{
+    if (state_ == kDisconnected)
+    {
+        return; // 可写事件先发现了连接关闭
+    }
+    FlightRecorder::record(FlightRecorder::kRead, channel_->fd(), n, savedErr);
+    if (n > 0)
+    {
+        inputBuffer_.append(data, n);
+        recvPending_ = true;
+        recvTime_ = receiveTime;
+        return;
+    }
+
+    flushReceived(); // 关闭前先处理已经收到的数据
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (n == 0)
+    {
+        handleClose();
+    }
+    else
+    {
+        errno = savedErr;
+        LOG_ERROR("TcpConnection::handleRecvCompletion");
+        handleError();
+        // multishot recv出错后已经结束，不会再有可读事件报告连接关闭
+        handleClose();
+    }
+}
+
+void TcpConnection::handleRecvBatchEnd()
+{
+    if (state_ != kDisconnected)
+    {
+        flushReceived();
+    }
+}
+
+void TcpConnection::flushReceived()
+{
+    if (recvPending_)
+    {
+        recvPending_ = false;
+        messageCallback_(shared_from_this(), &inputBuffer_, recvTime_);
+    }
+}
+
+/**
+ * @brief 把outputBuffer_中的全部数据交给Poller发送，连接在完成之前不会析构
+ */
+void TcpConnection::submitOutput()
+{
+    sending_ = true;
+    loop_->submitSend(channel_.get(), outputBuffer_.peek(), outputBuffer_.readableBytes(), shared_from_this());
+}
+
+/**
+ * @brief io_uring完成模式下send的结果，与handleWrite对应
+ */
+void TcpConnection::handleSendCompletion(ssize_t n, int savedErr)
+{
+    sending_ = false;
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    if (n < 0)
+    {
+        // 对端已经关闭或重置，剩余的数据不再发送，连接关闭由recv报告
+        errno = savedErr;
+        LOG_ERROR("TcpConnection::handleSendCompletion");
+        outputBuffer_.retrieveAll();
+        pendingOutput_.retrieveAll();
+        return;
+    }
+
+    outputBuffer_.retrieve(n);
+    FlightRecorder::record(FlightRecorder::kWrite, channel_->fd(), n, outputBuffer_.readableBytes() + pendingOutput_.readableBytes());
+    if (pendingOutput_.readableBytes() > 0)
+    {
+        if (outputBuffer_.readableBytes() == 0)
+        {
+            outputBuffer_.swap(pendingOutput_);
+        }
+        else
+        {
+            outputBuffer_.append(pendingOutput_.peek(), pendingOutput_.readableBytes());
+            pendingOutput_.retrieveAll();
+        }
+    }
+    if (outputBuffer_.readableBytes() > 0)
+    {
+        submitOutput();
+        return;
+    }
+
+    if (writeCompleteCallback_)
+    {
+        loop_->queueInLoop(std::bind(writeCompleteCallback_, shared_from_this()));
+    }
+    if (state_ == kDisconnecting)
+    {
+        shutdownInLoop();
+    }
+}
+
 void TcpConnection::handleWrite()
 {
     if (channel_->isWriting())
@@ -190,6 +375,7 @@ void TcpConnection::handleWrite()
         if (n > 0)
         {
             outputBuffer_.retrieve(n);
+            FlightRecorder::record(FlightRecorder::kWrite, channel_->fd(), n, outputBuffer_.readableBytes());
             // 如果outputBuffer_的可读内容为空，说明数据已经全部写完
             if (outputBuffer_.readableBytes() == 0)
             {
@@ -221,6 +407,7 @@ void TcpConnection::handleWrite()
 void TcpConnection::handleClose()
 {
     LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_->fd(), (int)state_);
+    FlightRecorder::record(FlightRecorder::kConnDown, channel_->fd(), state_);
 
     setState(kDisconnected);
     channel_->disableAll();
@@ -230,7 +417,8 @@ void TcpConnection::handleClose()
     // 区分连接关闭的回调跟关闭连接的回调
     // 连接关闭---当连接关闭时，执行的回调
     // 关闭连接---手动的关闭连接
-    connectionCallback_(connPtr); // 执行连接关闭的回调
+    ConnectionCallback cb = connectionCallback_;
+    cb(connPtr);                  // 执行连接关闭的回调
     closeCallback_(connPtr);      // 关闭连接的回调  执行的是TcpServer::removeConnection回调方法
 }
 
@@ -252,7 +440,8 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
+    FlightRecorder::record(FlightRecorder::kError, channel_->fd(), err);
+    LOG_ERROR_RATELIMIT(10, "TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
 }
 
 /**
@@ -270,11 +459,33 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
         return;
     }
 
+    if (sendCompletion_)
+    {
+        // io_uring完成模式：不直接write，数据进入缓冲区后由Poller提交send，和本轮其它请求一起提交
+        size_t oldLen = outputBuffer_.readableBytes() + pendingOutput_.readableBytes();
+        if (oldLen + len >= highWaterMark_ && oldLen < highWaterMark_ && highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + len));
+        }
+        FlightRecorder::record(FlightRecorder::kSend, channel_->fd(), len, 0);
+        if (sending_)
+        {
+            pendingOutput_.append(static_cast<const char *>(data), len);
+        }
+        else
+        {
+            outputBuffer_.append(static_cast<const char *>(data), len);
+            submitOutput();
+        }
+        return;
+    }
+
     // 如果outputBuffer_为空，说明数据可以直接写到fd中
     if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
     {
         // 直接调用write函数发送数据到fd
         nwrote = write(channel_->fd(), data, len);
+        FlightRecorder::record(FlightRecorder::kSend, channel_->fd(), len, nwrote);
         if (nwrote >= 0)
         {
             remaining = len - nwrote; // 剩余的数据
@@ -324,7 +535,7 @@ void TcpConnection::sendInLoop(const void *data, size_t len)
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明outputBuffer中的数据已经全部发送完成
+    if (!channel_->isWriting() && !sending_) // 说明outputBuffer中的数据已经全部发送完成
     {
         socket_->shutdownWrite(); // 关闭写端
     }
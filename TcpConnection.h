@@ -37,6 +37,12 @@ public:
     }
 
     void send(const std::string &msg);
+    void send(const void *data, size_t len);
+    void send(Buffer *buf); // 发送buf中全部可读数据并清空buf
+
+    Buffer *inputBuffer() { return &inputBuffer_; }
+    // 只用于查询待发送的数据量。io_uring完成模式下其中的数据可能正由内核发送，不能直接修改
+    Buffer *outputBuffer() { return &outputBuffer_; }
     void shutdown();
 
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
@@ -66,11 +72,17 @@ private:
     void setState(StateE state) { state_ = state; }
 
     void handleRead(Timestamp receiveTime);
+    void handleRecvCompletion(const char *data, ssize_t n, int savedErr, Timestamp receiveTime);
+    void handleRecvBatchEnd();
+    void flushReceived();
+    void submitOutput();
+    void handleSendCompletion(ssize_t n, int savedErr);
     void handleWrite();
     void handleClose();
     void handleError();
 
     void sendInLoop(const void *message, size_t len);
+    void sendStringInLoop(const std::string &msg);
     void shutdownInLoop();
     void forceCloseInLoop(); // 在io线程中强制关闭连接
     // IO线程
@@ -97,6 +109,16 @@ private:
 
     Buffer inputBuffer_;  // 接收数据的缓冲区
     Buffer outputBuffer_; // 发送数据的缓冲区
+
+    // io_uring完成模式下一轮recv的数据先追加到inputBuffer_，本轮结束时调用一次messageCallback_
+    bool recvPending_;
+    Timestamp recvTime_;
+
+    // io_uring完成模式下发送也由Poller提交：outputBuffer_中的数据在途时，新数据先追加到pendingOutput_，
+    // send完成后合并进outputBuffer_再提交，每个连接同时只有一个send
+    bool sendCompletion_;
+    bool sending_;
+    Buffer pendingOutput_;
 };
 
 void defaultConnectionCallback(const TcpConnectionPtr &conn);                                     // 连接回调函数
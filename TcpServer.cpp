@@ -20,21 +20,49 @@ static EventLoop *CheckLoopNotNull(EventLoop *loop)
  */
 TcpServer::TcpServer(EventLoop *loop, const InetAddr &listenAddr, const std::string &nameArg, Option option)
     : loop_(CheckLoopNotNull(loop)),
+      listenAddr_(listenAddr),
       ipPort_(listenAddr.toIpPort()),
       name_(nameArg),
-      acceptor_(new Acceptor(loop, listenAddr, option == kReusePort)),
+      option_(option),
+      acceptBatch_(Acceptor::kDefaultAcceptBatch),
       threadPool_(new EventLoopThreadPool(loop, name_)),
       connectionCallback_(),
       messageCallback_(),
-      nextConnId_(1),
-      started_(0)
+      started_(0),
+      nextConnId_(1)
 {
-    acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+    if (option_ != kReusePortPerLoop)
+    {
+        acceptor_.reset(new Acceptor(loop, listenAddr, option == kReusePort));
+        acceptor_->setNewConnectionCallback(std::bind(&TcpServer::newConnection, this, std::placeholders::_1, std::placeholders::_2));
+        acceptor_->setAcceptBatchDoneCallback(std::bind(&TcpServer::dispatchPendingConnections, this));
+    }
 }
 
 TcpServer::~TcpServer()
 {
-    for (auto &item : connections_)
+    if (!loopAcceptors_.empty())
+    {
+        // 每个Acceptor和连接都属于各自的loop，只能在那个loop中销毁；必须等它们都销毁之后再继续，
+        // 否则loop还可能通过newConnectionInLoop/removeConnection回调已经析构的TcpServer
+        std::vector<std::promise<void>> done(loopAcceptors_.size());
+        for (size_t i = 0; i < loopAcceptors_.size(); ++i)
+        {
+            loopAcceptors_[i]->getLoop()->runInLoop(std::bind(&TcpServer::stopInLoop, this, i, &done[i]),
+                                                    EventLoop::kHighPriority);
+        }
+        for (std::promise<void> &d : done)
+        {
+            d.get_future().wait();
+        }
+    }
+
+    ConnectionMap connections;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections.swap(connections_);
+    }
+    for (auto &item : connections)
     {
         // 这个局部的shared_ptr智能指针对象，出右括号，可以自动释放new出来的TcpConnection对象资源了
         TcpConnectionPtr conn(item.second);
@@ -45,6 +73,39 @@ TcpServer::~TcpServer()
     }
 }
 
+/**
+ * @brief 在loopAcceptors_[index]所属的loop中执行：销毁Acceptor(不再accept)，再销毁这个loop的所有连接。
+ * connectDestroyed之后连接的channel不再关注任何事件，不会再调用TcpServer::removeConnection
+ */
+void TcpServer::stopInLoop(size_t index, std::promise<void> *done)
+{
+    std::shared_ptr<Acceptor> acceptor;
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        acceptor.swap(loopAcceptors_[index]);
+        EventLoop *ioLoop = acceptor->getLoop();
+        for (auto it = connections_.begin(); it != connections_.end();)
+        {
+            if (it->second->getLoop() == ioLoop)
+            {
+                conns.push_back(it->second);
+                it = connections_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    acceptor.reset();
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectDestroyed();
+    }
+    done->set_value();
+}
+
 /**
  * @brief 设置底层subloop的个数
  */
@@ -53,6 +114,37 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setAcceptBatch(int batch)
+{
+    acceptBatch_ = batch;
+    if (acceptor_)
+    {
+        acceptor_->setAcceptBatch(batch);
+    }
+}
+
+int64_t TcpServer::numRejectedConnections() const
+{
+    int64_t n = acceptor_ ? acceptor_->numRejected() : 0;
+    std::lock_guard<std::mutex> lock(mutex_); // loopAcceptors_可能正在start()中添加
+    for (const std::shared_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        n += acceptor ? acceptor->numRejected() : 0;
+    }
+    return n;
+}
+
+int64_t TcpServer::numAcceptPauses() const
+{
+    int64_t n = acceptor_ ? acceptor_->numPauses() : 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::shared_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        n += acceptor ? acceptor->numPauses() : 0;
+    }
+    return n;
+}
+
 /**
  * @brief 开启最上层服务器监听.
  * 1. 启动IO线程池
@@ -64,6 +156,23 @@ void TcpServer::start()
     {
         // 启动IO线程池
         threadPool_->start(threadInitCallback_);
+        if (option_ == kReusePortPerLoop)
+        {
+            // 每个loop一个监听socket，都在这里绑定，绑定失败时在调用线程中报错
+            for (EventLoop *ioLoop : threadPool_->getAllLoops())
+            {
+                std::shared_ptr<Acceptor> acceptor(new Acceptor(ioLoop, listenAddr_, true));
+                acceptor->setAcceptBatch(acceptBatch_);
+                acceptor->setNewConnectionCallback(std::bind(&TcpServer::newConnectionInLoop, this, ioLoop,
+                                                             std::placeholders::_1, std::placeholders::_2));
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    loopAcceptors_.push_back(acceptor);
+                }
+                ioLoop->runInLoop(std::bind(&Acceptor::listen, acceptor.get()));
+            }
+            return;
+        }
         // 启动服务线程-mainLoop监听新连接
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get())); // 启动最上层的loop监听新客户端连接
     }
@@ -76,11 +185,66 @@ void TcpServer::newConnection(int sockfd, const InetAddr &peerAddr)
 {
     // 轮询算法，选择一个subLoop(IO线程)，来管理channel
     EventLoop *ioLoop = threadPool_->getNextLoop();
+    TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+
+    // 没有subLoop时直接建立连接
+    if (ioLoop == loop_)
+    {
+        conn->connectEstablished();
+        return;
+    }
+    // 先攒着，这一批accept结束时再统一唤醒subLoop
+    for (auto &pending : pendingConnections_)
+    {
+        if (pending.first == ioLoop)
+        {
+            pending.second.push_back(conn);
+            return;
+        }
+    }
+    pendingConnections_.emplace_back(ioLoop, std::vector<TcpConnectionPtr>(1, conn));
+}
+
+/**
+ * @brief 每个subLoop一个任务，在subLoop中依次建立这一批分给它的连接
+ */
+static void establishConnections(const std::vector<TcpConnectionPtr> &conns)
+{
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        conn->connectEstablished();
+    }
+}
+
+void TcpServer::dispatchPendingConnections()
+{
+    for (auto &pending : pendingConnections_)
+    {
+        if (!pending.second.empty())
+        {
+            std::vector<TcpConnectionPtr> conns;
+            conns.swap(pending.second);
+            pending.first->queueInLoop(std::bind(establishConnections, std::move(conns)), EventLoop::kHighPriority);
+        }
+    }
+}
+
+/**
+ * @brief kReusePortPerLoop时新连接在ioLoop自己的Acceptor上accept，就在当前线程中建立连接
+ */
+void TcpServer::newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddr &peerAddr)
+{
+    createConnection(ioLoop, sockfd, peerAddr)->connectEstablished();
+}
 
+/**
+ * @brief 创建TcpConnection对象，设置回调并登记到connections_中
+ */
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddr &peerAddr)
+{
     // 创建TcpConnection对象
     char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_);
-    ++nextConnId_;
+    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_++);
     std::string connName = name_ + buf;
 
     LOG_INFO("TcpServer::newConnection [%s] - new connection [%s] from %s \n",
@@ -101,7 +265,10 @@ void TcpServer::newConnection(int sockfd, const InetAddr &peerAddr)
 
     // 根据连接成功的sockfd，创建TcpConnection连接对象
     TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
-    connections_[connName] = conn;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_[connName] = conn;
+    }
 
     // 设置连接的各种回调函数
     conn->setConnectionCallback(connectionCallback_);
@@ -111,10 +278,7 @@ void TcpServer::newConnection(int sockfd, const InetAddr &peerAddr)
     // 设置了如何关闭连接的回调   conn->shutDown()
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
-
-    // 建立连接
-    //  直接调用TcpConnection::connectEstablished、
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    return conn;
 }
 
 /**
@@ -122,6 +286,12 @@ void TcpServer::newConnection(int sockfd, const InetAddr &peerAddr)
  */
 void TcpServer::removeConnection(const TcpConnectionPtr &conn)
 {
+    if (option_ == kReusePortPerLoop)
+    {
+        // 连接在哪个loop中建立就在哪个loop中删除，不经过mainLoop
+        removeConnectionInLoop(conn);
+        return;
+    }
     loop_->runInLoop(std::bind(&TcpServer::removeConnectionInLoop, this, conn));
 }
 
@@ -132,7 +302,10 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 {
     LOG_INFO("TcpServer::removeConnectionInLoop [%s] - connection %s\n",
              name_.c_str(), conn->name().c_str());
-    connections_.erase(conn->name());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connections_.erase(conn->name());
+    }
     EventLoop *ioLoop = conn->getLoop();
 
     // 放到连接所属的loop中执行回调
@@ -12,7 +12,10 @@
 #include <string>
 #include <memory>
 #include <atomic>
+#include <mutex>
+#include <future>
 #include <unordered_map>
+#include <vector>
 
 /**
  * @brief 对外提供的TcpServer类、用于上层网络编程中的服务器端
@@ -23,15 +26,23 @@ public:
     using ThreadInitCallBack = std::function<void(EventLoop *)>;
 
     /**
-     * @brief Option枚举类的作用是设置是否重用端口
+     * @brief Option枚举类的作用是设置是否重用端口.
+     * kReusePortPerLoop：不在mainLoop上accept，线程池的每个loop各自创建一个SO_REUSEPORT的监听socket和Acceptor，
+     * 由内核把新连接分给各个监听socket，每个loop在本线程中accept并直接建立连接，不需要经过mainLoop唤醒subLoop。
+     * 连接的分配由内核按四元组的哈希决定，不再是轮询；监听socket在start()时才创建和绑定
      */
     enum Option
     {
         kNoReusePort,
         kReusePort,
+        kReusePortPerLoop,
     };
     TcpServer(EventLoop *loop, const InetAddr &listenAddr, const std::string &nameArg, Option option = kNoReusePort);
 
+    /**
+     * @brief 在mainLoop线程中析构。kReusePortPerLoop时等每个loop在自己的线程中销毁Acceptor和连接之后才返回，
+     * 之后不会再有loop回调到这个TcpServer
+     */
     ~TcpServer();
 
     // 设置回调函数
@@ -42,16 +53,31 @@ public:
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
 
     void setThreadNum(int numThreads); // 设置线程池的线程数量
+    void setAcceptBatch(int batch);    // 一次可读事件最多accept的连接数，在start()之前调用
 
     void start(); // 开启服务器监听
 
+    // 因为fd耗尽被accept后立即关闭的连接数、暂停accept的次数，所有Acceptor的总和，可以在任意线程读取
+    int64_t numRejectedConnections() const;
+    int64_t numAcceptPauses() const;
+
 private:
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
     EventLoop *loop_; // 服务器监听的EventLoop-mainLoop
+    const InetAddr listenAddr_;
     const std::string ipPort_;
     const std::string name_;
+    const Option option_;
+
+    std::unique_ptr<Acceptor> acceptor_; // 运行在mainLoop，任务就是监听新连接事件，kReusePortPerLoop时为空
+
+    // kReusePortPerLoop时每个loop一个Acceptor，在各自的loop中使用和销毁(销毁后为空)。
+    // 在start()中添加、在stopInLoop中取出时持有mutex_，统计计数的函数在其它线程中遍历
+    std::vector<std::shared_ptr<Acceptor>> loopAcceptors_;
+    int acceptBatch_;
 
-    std::unique_ptr<Acceptor> acceptor_; // 运行在mainLoop，任务就是监听新连接事件
+    // mainLoop一批accept的连接按所属的subLoop分组，一批结束时每个subLoop只queueInLoop一次。只在mainLoop中使用
+    std::vector<std::pair<EventLoop *, std::vector<TcpConnectionPtr>>> pendingConnections_;
 
     std::shared_ptr<EventLoopThreadPool> threadPool_; // 线程池,mainLoop-->subLoop,用于处理新连接的读写事件
 
@@ -70,12 +96,17 @@ private:
     ThreadInitCallBack threadInitCallback_; // 线程初始化回调函数
 
     std::atomic_int started_;
-    int nextConnId_; // 下一个连接的id
+    std::atomic_int nextConnId_; // 下一个连接的id
 
+    mutable std::mutex mutex_;  // kReusePortPerLoop时多个loop同时增删连接、loopAcceptors_，以及析构时取出所有连接
     ConnectionMap connections_; // 存放所有的连接
 
 private:
     void newConnection(int sockfd, const InetAddr &peerAddr);  // 新连接到来时的回调函数
+    void newConnectionInLoop(EventLoop *ioLoop, int sockfd, const InetAddr &peerAddr); // 在ioLoop中accept的新连接
+    void dispatchPendingConnections();                         // 一批accept结束，把新连接交给各个subLoop
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddr &peerAddr); // 创建并登记连接
     void removeConnection(const TcpConnectionPtr &conn);       // 删除连接
     void removeConnectionInLoop(const TcpConnectionPtr &conn); // 在loop中删除连接
+    void stopInLoop(size_t index, std::promise<void> *done);  // kReusePortPerLoop析构时在各个loop中停止accept并销毁连接
 };
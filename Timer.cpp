@@ -1,11 +1,17 @@
 #include "Timer.h"
 
-Timer::Timer(TimerCallback cb, Timestamp when, double interval)
+std::atomic_int64_t Timer::s_numCreated_(0);
+
+Timer::Timer(TimerCallback cb, MonotonicTime when, double interval, int64_t slackUs)
     : callback_(std::move(cb)),
       expiration_(when),
       interval_(interval),
       repeat_(interval > 0.0),
-      sequence_(s_numCreated_.fetch_add(1))
+      slackUs_(slackUs),
+      sequence_(s_numCreated_.fetch_add(1)),
+      wheelPrev_(nullptr),
+      wheelNext_(nullptr),
+      wheelSlot_(-1)
 {
 }
 
@@ -13,7 +19,7 @@ Timer::~Timer()
 {
 }
 
-void Timer::restart(Timestamp now)
+void Timer::restart(MonotonicTime now)
 {
     if (repeat_)
     {
@@ -21,6 +27,6 @@ void Timer::restart(Timestamp now)
     }
     else
     {
-        expiration_ = Timestamp::invalid();
+        expiration_ = MonotonicTime::invalid();
     }
 }
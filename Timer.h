@@ -8,23 +8,34 @@ class Timer : noncopyable
 {
 private:
     const TimerCallback callback_;
-    Timestamp expiration_;   // 过期时间
-    const double interval_;  // 间隔时间
-    const bool repeat_;      // 是否重复
-    const int64_t sequence_; // 序列号
+    MonotonicTime expiration_; // 过期时间(单调时钟)
+    const double interval_;    // 间隔时间
+    const bool repeat_;        // 是否重复
+    const int64_t slackUs_;    // 允许推迟执行的微秒数，0表示精确到期
+    const int64_t sequence_;   // 序列号
     // static std::atomic_int
     static std::atomic_int64_t s_numCreated_; // 已创建的定时器数量
+
+    // 时间轮槽内的双向链表节点和所在的槽，由WheelTimerQueue维护
+    friend class WheelTimerQueue;
+    Timer *wheelPrev_;
+    Timer *wheelNext_;
+    int wheelSlot_;
+
 public:
-    Timer(TimerCallback cb, Timestamp when, double interval);
+    Timer(TimerCallback cb, MonotonicTime when, double interval, int64_t slackUs = 0);
     ~Timer();
 
     void run() const { callback_(); }
 
-    Timestamp expiration() const { return expiration_; }
+    MonotonicTime expiration() const { return expiration_; }
     bool repeat() const { return repeat_; }
+    int64_t slackUs() const { return slackUs_; }
     int64_t sequence() const { return sequence_; }
 
     static int64_t numCreated() { return s_numCreated_; }
 
-    void restart(Timestamp now); // 重启定时器
+    void restart(MonotonicTime now); // 重启定时器
+    // 在[expiration, expiration + slack]内调整到期时间，由TimerQueue合并唤醒时调用
+    void setExpiration(MonotonicTime when) { expiration_ = when; }
 };
@@ -19,5 +19,5 @@ public:
     TimerId(Timer *timer, int64_t seq)
         : timer_(timer),
           sequence_(seq){};
-    ~TimerId();
+    ~TimerId() = default;
 };
@@ -0,0 +1,71 @@
+#include "TimerPool.h"
+#include "Timer.h"
+
+#include <new>
+
+TimerPool::TimerPool()
+    : freeList_(nullptr)
+{
+}
+
+/**
+ * @brief 释放池中剩余的Timer
+ */
+TimerPool::~TimerPool()
+{
+    for (const std::unique_ptr<Slot[]> &chunk : chunks_)
+    {
+        for (size_t i = 0; i < kSlotsPerChunk; ++i)
+        {
+            if (chunk[i].sequence.load(std::memory_order_relaxed) >= 0)
+            {
+                reinterpret_cast<Timer *>(chunk[i].storage)->~Timer();
+            }
+        }
+    }
+}
+
+void TimerPool::grow()
+{
+    std::unique_ptr<Slot[]> chunk(new Slot[kSlotsPerChunk]);
+    for (size_t i = 0; i < kSlotsPerChunk; ++i)
+    {
+        chunk[i].sequence.store(-1, std::memory_order_relaxed);
+        chunk[i].nextFree = i + 1 < kSlotsPerChunk ? &chunk[i + 1] : freeList_;
+    }
+    freeList_ = &chunk[0];
+    chunks_.push_back(std::move(chunk));
+}
+
+Timer *TimerPool::create(const TimerCallback &cb, MonotonicTime when, double interval, int64_t slackUs)
+{
+    Slot *slot;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (freeList_ == nullptr)
+        {
+            grow();
+        }
+        slot = freeList_;
+        freeList_ = slot->nextFree;
+    }
+    // 槽已经从空闲链表中摘下，在锁外构造
+    Timer *timer = new (slot->storage) Timer(cb, when, interval, slackUs);
+    slot->sequence.store(timer->sequence(), std::memory_order_relaxed);
+    return timer;
+}
+
+void TimerPool::destroy(Timer *timer)
+{
+    Slot *slot = slotOf(timer);
+    slot->sequence.store(-1, std::memory_order_relaxed);
+    timer->~Timer();
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->nextFree = freeList_;
+    freeList_ = slot;
+}
+
+bool TimerPool::contains(Timer *timer, int64_t sequence) const
+{
+    return timer != nullptr && slotOf(timer)->sequence.load(std::memory_order_relaxed) == sequence;
+}
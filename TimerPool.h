@@ -0,0 +1,49 @@
+#pragma once
+#include "noncopyable.h"
+#include "CallBacks.h"
+#include "Timestamp.h"
+#include "Timer.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * @brief 每个TimerQueue一个的Timer对象池。
+ * Timer按块分配、在池销毁前不归还给系统，释放的槽放回空闲链表，创建和释放没有堆分配。
+ * 槽中记录当前Timer的序列号作为代数(释放后为-1)，TimerId(Timer*, sequence)可以O(1)判断是否仍然有效，
+ * 槽的内存一直有效，校验时不会访问已经释放的内存。
+ * addTimer可以在任意线程调用，空闲链表用互斥锁保护
+ */
+class TimerPool : noncopyable
+{
+public:
+    TimerPool();
+    ~TimerPool();
+
+    Timer *create(const TimerCallback &cb, MonotonicTime when, double interval, int64_t slackUs);
+    void destroy(Timer *timer);
+
+    /**
+     * @brief timer所在的槽中是否仍然是序列号为sequence的定时器
+     */
+    bool contains(Timer *timer, int64_t sequence) const;
+
+private:
+    struct Slot
+    {
+        alignas(Timer) unsigned char storage[sizeof(Timer)]; // Timer对象，必须是第一个成员
+        std::atomic<int64_t> sequence;                       // 当前Timer的序列号，空闲时为-1
+        Slot *nextFree;
+    };
+    static const size_t kSlotsPerChunk = 1024;
+
+    static Slot *slotOf(Timer *timer) { return reinterpret_cast<Slot *>(timer); }
+    void grow(); // 分配一个新块并加入空闲链表
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Slot[]>> chunks_;
+    Slot *freeList_;
+};
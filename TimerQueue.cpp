@@ -27,11 +27,11 @@ int createTimerfd()
  * 读取定时器文件描述符
 
 */
-void readTimerfd(int timerfd, Timestamp now)
+void readTimerfd(int timerfd, MonotonicTime now)
 {
     uint64_t howmany;                                      // 定时器到期次数
     ssize_t n = ::read(timerfd, &howmany, sizeof howmany); // 读取定时器文件描述符
-    LOG_DEBUG("TimerQueue::handleRead() %lu at %s\n", howmany, now.toFormattedString().c_str());
+    LOG_DEBUG("TimerQueue::handleRead() %lu at %ld us\n", howmany, now.microSeconds());
     if (n != sizeof howmany)
     {
         LOG_ERROR("TimerQueue::handleRead() reads %lu bytes instead of 8\n", n);
@@ -39,47 +39,57 @@ void readTimerfd(int timerfd, Timestamp now)
 }
 
 /**
- * 计算超时时间
+ * 到期时间转换为timerfd_settime的绝对时间(TFD_TIMER_ABSTIME)。
+ * timerfd和到期时间都是CLOCK_MONOTONIC，不需要读取当前时间；已经过去的时间会让timerfd立即触发
  */
-struct timespec howMuchTimeFromNow(Timestamp when)
+struct timespec toTimespec(MonotonicTime when)
 {
-    // 计算目标时间和当前时间的差值，以微秒为单位
-    int64_t microseconds = when.microSecondsSinceEpoch() - Timestamp::now().microSecondsSinceEpoch();
-
-    // 如果时间差小于 100 微秒，设为 100 微秒
-    if (microseconds < 100)
-    {
-        microseconds = 100;
-    }
-
-    // 将时间差转换为 timespec 结构体
     struct timespec ts;
-    ts.tv_sec = static_cast<time_t>(microseconds / Timestamp::kMicroSecondsPerSecond);         // 秒
-    ts.tv_nsec = static_cast<long>((microseconds % Timestamp::kMicroSecondsPerSecond) * 1000); // 纳秒
-
+    ts.tv_sec = static_cast<time_t>(when.nanoSeconds() / MonotonicTime::kNanoSecondsPerSecond);  // 秒
+    ts.tv_nsec = static_cast<long>(when.nanoSeconds() % MonotonicTime::kNanoSecondsPerSecond); // 纳秒
     return ts;
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
+/**
+ * 按Linux内核apply_slack的方法把到期时间向后对齐：
+ * 在[when, when + slack]内找最粗的2的幂微秒边界，相近的到期时间会被对齐到同一个值
+ */
+MonotonicTime roundUpWithSlack(MonotonicTime when, int64_t slackUs)
 {
-    std::vector<Entry> expired; // 过期定时器列表
-    // reinterpret_cast<Timer *>(UINTPTR_MAX) 是为了在 timers_ 中找到第一个未到期的定时器
-    // 关于reiterpret_cast的用法，可以参笔记
-    Entry sentry(now, reinterpret_cast<Timer *>(UINTPTR_MAX)); // 超时时间和定时器指针
-
-    // 返回第一个未到期的定时器的迭代器
-    TimerList::iterator end = timers_.lower_bound(sentry);
-    std::copy(timers_.begin(), end, back_inserter(expired)); // 将到期的定时器加入到 expired 中
-
-    // 从 timers_ 中移除到期的定时器
-    timers_.erase(timers_.begin(), end);
+    int64_t expires = when.microSeconds();
+    int64_t limit = expires + slackUs;
+    uint64_t mask = static_cast<uint64_t>(expires ^ limit);
+    if (mask == 0)
+    {
+        return when;
+    }
+    int bit = 63 - __builtin_clzll(mask); // 不同的最高位
+    limit &= ~((static_cast<int64_t>(1) << bit) - 1);
+    return MonotonicTime(limit * 1000);
+}
 
-    for (const Entry &it : expired)
+/**
+ * @brief 已经安排的下一次唤醒在定时器的slack范围内时直接并入，否则对齐到2的幂边界。
+ * 只能在loop线程中、插入队列之前调用
+ */
+void TimerQueue::applySlack(Timer *timer)
+{
+    const int64_t slackUs = timer->slackUs();
+    if (slackUs <= 0)
+    {
+        return;
+    }
+    MonotonicTime when = timer->expiration();
+    MonotonicTime next = nextExpiration();
+    if (next.valid() && !(next < when) && next.nanoSeconds() <= when.nanoSeconds() + slackUs * 1000)
     {
-        ActiveTimer timer(it.second, it.second->sequence());
-        size_t n = activeTimers_.erase(timer);
+        timer->setExpiration(next);
+        numCoalesced_.fetch_add(1, std::memory_order_relaxed);
+    }
+    else
+    {
+        timer->setExpiration(roundUpWithSlack(when, slackUs));
     }
-    return expired; // 返回到期的定时器
 }
 
 /**
@@ -87,70 +97,48 @@ std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timestamp now)
  * @param expired 过期定时器列表
  * @param now 读事件发生当前时间
  */
-void TimerQueue::reset(const std::vector<Entry> &expired, Timestamp now)
+void TimerQueue::reset(const std::vector<Timer *> &expired, MonotonicTime now)
 {
-    Timestamp nextExpire;
-
-    for (const Entry &it : expired)
+    for (Timer *timer : expired)
     {
-        ActiveTimer timer(it.second, it.second->sequence()); // 用已过期的定时器构造活动定时器
+        ActiveTimer active(timer, timer->sequence()); // 用已过期的定时器构造活动定时器
         // 如果是重复定时器，并且不在取消定时器集合中
-        if (it.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end())
+        if (timer->repeat() && cancelingTimers_.find(active) == cancelingTimers_.end())
         {
-            it.second->restart(now); // 重启定时器
-            insert(it.second);       // 插入定时器
+            timer->restart(now); // 重启定时器
+            applySlack(timer);
+            insert(timer); // 插入定时器
         }
         else
         {
             // 释放定时器
-            delete it.second;
+            pool_.destroy(timer);
         }
     }
-    if (!timers_.empty())
-    {
-        nextExpire = timers_.begin()->first; // 获取最早到期的定时器
-    }
 
-    if (nextExpire.valid())
+    MonotonicTime nextExpire = nextExpiration(); // 获取最早到期的定时器
+    if (nextExpire.valid() && useTimerfd_)
     {
-        //
         resetTimerfd(timerfd_, nextExpire); // 重置定时器
     }
 }
 
-/**
- * 插入定时器
- * @return 是否最早到期的定时器改变
- */
-bool TimerQueue::insert(Timer *timer)
+void TimerQueue::resetTimerfd(int timerfd, MonotonicTime expiration)
 {
-    bool earliestChanged = false;         // 是否最早到期的定时器改变
-    Timestamp when = timer->expiration(); // 获取定时器到期时间
-    TimerList::iterator it = timers_.begin();
-    // 如果 timers_ 为空或者 when 小于 timers_ 中的第一个定时器的到期时间
-    if (it == timers_.end() || when < it->first)
-    {
-        earliestChanged = true; // 最早到期的定时器改变
-    }
-    {
-        // 插入定时器
-        std::pair<TimerList::iterator, bool> result = timers_.insert(Entry(when, timer));
-    }
+    // timerfd已经设置为同一个时间，不需要再调用timerfd_settime
+    if (expiration == armedExpiration_)
     {
-        // 插入活动定时器
-        std::pair<ActiveTimerSet::iterator, bool> result = activeTimers_.insert(ActiveTimer(timer, timer->sequence()));
+        numSettimesSkipped_.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    return earliestChanged;
-}
-
-void TimerQueue::resetTimerfd(int timerfd, Timestamp expiration)
-{
+    armedExpiration_ = expiration;
+    numTimerfdSettimes_.fetch_add(1, std::memory_order_relaxed);
     struct itimerspec newValue;
     struct itimerspec oldValue;
     memset(&newValue, 0, sizeof newValue);                         // Zero-initialize the newValue structure
     memset(&oldValue, 0, sizeof oldValue);                         // Zero-initialize the oldValue structure
-    newValue.it_value = howMuchTimeFromNow(expiration);            // 设置超时时间
-    int ret = ::timerfd_settime(timerfd, 0, &newValue, &oldValue); // 设置定时器超时时间
+    newValue.it_value = toTimespec(expiration);                                     // 设置超时时间
+    int ret = ::timerfd_settime(timerfd, TFD_TIMER_ABSTIME, &newValue, &oldValue); // 设置定时器超时时间
     if (ret)
     {
         LOG_ERROR("timerfd_settime()");
@@ -161,11 +149,12 @@ void TimerQueue::addTimerInLoop(Timer *timer)
 {
     if (loop_->isInLoopThread())
     {
+        applySlack(timer);
         bool earliestChanged = insert(timer); // 插入定时器
-        // 如果最早到期的定时器改变
-        if (earliestChanged)
+        // 如果最早到期的定时器改变。不使用timerfd时EventLoop在下一次poll前会重新计算超时时间
+        if (earliestChanged && useTimerfd_)
         {
-            resetTimerfd(timerfd_, timer->expiration()); // 重置定时器
+            resetTimerfd(timerfd_, nextExpiration()); // 重置定时器
         }
     }
 }
@@ -176,72 +165,131 @@ void TimerQueue::cancelInLoop(TimerId timerId)
     {
         LOG_FATAL("cancelInLoop() is not in the loop thread!");
     }
-    ActiveTimer timer(timerId.timer_, timerId.sequence_); // 构造活动定时器
-    ActiveTimerSet::iterator it = activeTimers_.find(timer);
-    // 如果定时器在活动定时器集合中
-    if (it != activeTimers_.end())
+    // 通过对象池O(1)校验TimerId，已经到期释放或已经取消的定时器直接忽略
+    if (!pool_.contains(timerId.timer_, timerId.sequence_))
     {
-        size_t n = timers_.erase(Entry(it->first->expiration(), it->first)); // 从定时器列表中移除定时器
-        delete it->first;                                                    // 释放定时器
-        activeTimers_.erase(it);                                             // 从活动定时器集合中移除定时器
+        return;
+    }
+    if (remove(timerId.timer_))
+    {
+        pool_.destroy(timerId.timer_); // 释放定时器
     }
     else if (callingExpiredTimers_) // 如果正在调用到期的定时器
     {
         // 将定时器加入到取消定时器集合中
-        cancelingTimers_.insert(timer);
+        cancelingTimers_.insert(ActiveTimer(timerId.timer_, timerId.sequence_));
     }
 }
 
 void TimerQueue::handleRead()
 {
-    Timestamp now(Timestamp::now());
+    // timerfd的读事件在poll返回后立即分发，直接使用loop缓存的poll返回时间
+    MonotonicTime now(loop_->pollReturnMonotonic());
     readTimerfd(timerfd_, now);
-    std::vector<Entry> expired = getExpired(now); // 获取到期的定时器
-    callingExpiredTimers_ = true;                 // 正在调用到期的定时器
-    cancelingTimers_.clear();                     // 清空取消定时器集合
-    for (const Entry &it : expired)
+    armedExpiration_ = MonotonicTime::invalid(); // timerfd是一次性的，触发后需要重新设置
+    processExpired(now);
+}
+
+void TimerQueue::processExpired(MonotonicTime now)
+{
+    // 不使用timerfd时每次迭代都会调用，没有到期的定时器就直接返回
+    if (!useTimerfd_)
     {
-        it.second->run(); // 运行定时器
+        MonotonicTime next = nextExpiration();
+        if (!next.valid() || now < next)
+        {
+            return;
+        }
     }
+    expired_.clear();
+    getExpired(now, &expired_);   // 获取到期的定时器
+    callingExpiredTimers_ = true; // 正在调用到期的定时器
+    cancelingTimers_.clear();     // 清空取消定时器集合
+    LoopHeartbeat &heartbeat = loop_->heartbeat();
+    for (Timer *timer : expired_)
+    {
+        heartbeat.beginHandler(LoopHeartbeat::kTimer, timerfd_, timerfdChannel_.name());
+        timer->run(); // 运行定时器
+    }
+    heartbeat.endHandler();
     callingExpiredTimers_ = false; // 调用到期的定时器结束
-    reset(expired, now);           // 重置定时器
+    if (!expired_.empty())
+    {
+        numWakeups_.fetch_add(1, std::memory_order_relaxed);
+        numTimersRun_.fetch_add(static_cast<int64_t>(expired_.size()), std::memory_order_relaxed);
+    }
+    reset(expired_, now);          // 重置定时器
 }
 
-TimerQueue::TimerQueue(EventLoop *loop)
+TimerQueue::TimerQueue(EventLoop *loop, bool useTimerfd)
     : loop_(loop),
-      timerfd_(createTimerfd()),
+      useTimerfd_(useTimerfd),
+      timerfd_(useTimerfd ? createTimerfd() : -1),
       timerfdChannel_(loop, timerfd_),
-      timers_(),
-      callingExpiredTimers_(false)
+      callingExpiredTimers_(false),
+      defaultSlackUs_(0),
+      numWakeups_(0),
+      numTimersRun_(0),
+      numCoalesced_(0),
+      numTimerfdSettimes_(0),
+      numSettimesSkipped_(0)
 {
-    // we are always reading the timerfd, we disarm it with timerfd_settime.
-    // 我们总是读取timerfd，我们使用timerfd_settime来解除武装。
-    timerfdChannel_.setReadCallBack(std::bind(&TimerQueue::handleRead, this));
-    timerfdChannel_.enableReading();
+    timerfdChannel_.setName("timerfd");
+    if (useTimerfd_)
+    {
+        // we are always reading the timerfd, we disarm it with timerfd_settime.
+        // 我们总是读取timerfd，我们使用timerfd_settime来解除武装。
+        timerfdChannel_.setReadCallBack(std::bind(&TimerQueue::handleRead, this));
+        timerfdChannel_.enableReading();
+    }
 }
 
 TimerQueue::~TimerQueue()
 {
-    timerfdChannel_.disableAll();
-    timerfdChannel_.remove();
-    ::close(timerfd_);
-
-    //
-    for (const Entry &timer : timers_)
+    if (useTimerfd_)
     {
-        // 释放 Timer 对象
-        delete timer.second;
+        timerfdChannel_.disableAll();
+        timerfdChannel_.remove();
+        ::close(timerfd_);
     }
+    // 队列中剩余的Timer由pool_释放
 }
 
-TimerId TimerQueue::addTimer(const TimerCallback &cb, Timestamp when, double interval)
+TimerId TimerQueue::addTimer(const TimerCallback &cb, MonotonicTime when, double interval, double slack)
 {
-    Timer *timer = new Timer(cb, when, interval);                          // 创建定时器
+    int64_t slackUs = slack < 0 ? defaultSlackUs_.load(std::memory_order_relaxed)
+                                : static_cast<int64_t>(slack * Timestamp::kMicroSecondsPerSecond);
+    Timer *timer = pool_.create(cb, when, interval, slackUs);              // 创建定时器
     loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer)); // 在 IO 线程中添加定时器
     return TimerId(timer, timer->sequence());                              // 返回定时器 ID
 }
 
 void TimerQueue::cancel(TimerId timerId)
 {
-    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId)); // 在 IO 线程中取消定时器
+    // 在loop线程中直接取消，不构造std::function
+    if (loop_->isInLoopThread())
+    {
+        cancelInLoop(timerId);
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId)); // 在 IO 线程中取消定时器
+    }
+}
+
+void TimerQueue::setDefaultSlack(double seconds)
+{
+    int64_t slackUs = seconds > 0 ? static_cast<int64_t>(seconds * Timestamp::kMicroSecondsPerSecond) : 0;
+    defaultSlackUs_.store(slackUs, std::memory_order_relaxed);
+}
+
+TimerQueue::Stats TimerQueue::stats() const
+{
+    Stats stats;
+    stats.wakeups = numWakeups_.load(std::memory_order_relaxed);
+    stats.timersRun = numTimersRun_.load(std::memory_order_relaxed);
+    stats.coalesced = numCoalesced_.load(std::memory_order_relaxed);
+    stats.timerfdSettimes = numTimerfdSettimes_.load(std::memory_order_relaxed);
+    stats.settimesSkipped = numSettimesSkipped_.load(std::memory_order_relaxed);
+    return stats;
 }
@@ -1,42 +1,116 @@
 #pragma once
+#include "noncopyable.h"
 #include "Timestamp.h"
 #include "CallBacks.h"
 #include "Channel.h"
+#include "TimerPool.h"
 #include <set>
 #include <vector>
+#include <atomic>
+#include <stdint.h>
 
 class Timer;
 class EventLoop;
 class TimerId;
 
-class TimerQueue
+/**
+ * @brief 定时器队列，负责timerfd、跨线程添加/取消和到期回调的执行，
+ * 定时器的存放方式由子类实现：SetTimerQueue(红黑树)和WheelTimerQueue(分层时间轮)。
+ * 每个定时器可以带一个slack(类似Linux的timerslack)，表示允许推迟执行的时间：
+ * 插入时如果已经安排的下一次唤醒落在[到期时间, 到期时间 + slack]内就直接并入这次唤醒，
+ * 否则把到期时间向后对齐到区间内最粗的2的幂微秒边界，让相近的定时器落到同一个时刻一起执行，
+ * 减少loop的唤醒和timerfd_settime的次数。
+ * 到期时间使用单调时钟，timerfd也是CLOCK_MONOTONIC，调整系统时间不影响定时器
+ */
+class TimerQueue : noncopyable
 {
 public:
-    using Entry = std::pair<Timestamp, Timer *>;     // 时间戳和定时器指针
-    using TimerList = std::set<Entry>;               // 定时器列表
     using ActiveTimer = std::pair<Timer *, int64_t>; // 定时器指针和序列号
     using ActiveTimerSet = std::set<ActiveTimer>;    // 活动定时器集合
 
-    TimerQueue(EventLoop *loop);
-    ~TimerQueue();
-    TimerId addTimer(const TimerCallback &cb, Timestamp when, double interval);
+    /**
+     * @brief 默认使用SetTimerQueue，设置环境变量MUDUO_USE_TIMER_WHEEL后使用WheelTimerQueue
+     * @param useTimerfd 为false时不创建timerfd，由EventLoop根据nextExpiration()计算poll的超时时间、
+     * poll返回后调用processExpired()执行到期的定时器，省掉timerfd_settime和read两次系统调用
+     */
+    static TimerQueue *newDefaultTimerQueue(EventLoop *loop, bool useTimerfd = true);
+
+    /**
+     * @brief 定时器的统计，只在loop线程中更新，可以在任意线程读取
+     */
+    struct Stats
+    {
+        int64_t wakeups;         // 执行了定时器的唤醒次数
+        int64_t timersRun;       // 执行的定时器回调次数
+        int64_t coalesced;       // 因为slack并入已经安排好的唤醒的定时器数
+        int64_t timerfdSettimes; // timerfd_settime的调用次数
+        int64_t settimesSkipped; // 到期时间与timerfd已经设置的时间相同而省掉的timerfd_settime次数
+
+        // 与其它定时器共用一次唤醒的定时器数，即相对每个定时器单独唤醒省掉的唤醒次数
+        int64_t wakeupsSaved() const { return timersRun - wakeups; }
+    };
+
+    virtual ~TimerQueue();
+    /**
+     * @param slack 允许推迟执行的秒数，小于0时使用setDefaultSlack设置的值
+     */
+    TimerId addTimer(const TimerCallback &cb, MonotonicTime when, double interval, double slack = -1.0);
     void cancel(TimerId timerId);
 
+    // 设置之后添加的定时器的默认slack(秒)，默认为0即精确到期。可以在任意线程调用
+    void setDefaultSlack(double seconds);
+    Stats stats() const;
+
+    bool usesTimerfd() const { return useTimerfd_; }
+    // 最早到期的定时器的到期时间，没有定时器时返回MonotonicTime::invalid()。
+    // 允许返回一个更早的时间(例如时间轮的级联时刻)，到时processExpired可能没有定时器到期
+    virtual MonotonicTime nextExpiration() const = 0;
+    // 执行now之前到期的全部定时器、只能在loop线程中调用
+    void processExpired(MonotonicTime now);
+
+protected:
+    TimerQueue(EventLoop *loop, bool useTimerfd);
+
+    /**
+     * @brief 插入定时器
+     * @return 是否最早到期的定时器改变
+     */
+    virtual bool insert(Timer *timer) = 0;
+
+    /**
+     * @brief 从队列中删除定时器，不释放它。timer一定是有效的；
+     * 定时器不在队列中(已经到期、正在执行回调)时返回false
+     */
+    virtual bool remove(Timer *timer) = 0;
+
+    /**
+     * @brief 从队列中取出now之前到期的全部定时器
+     */
+    virtual void getExpired(MonotonicTime now, std::vector<Timer *> *expired) = 0;
+
 private:
-    void handleRead();                                            //  处理定时器事件
-    std::vector<Entry> getExpired(Timestamp now);                 // 获取所有过期定时器
-    void reset(const std::vector<Entry> &expired, Timestamp now); // 重置定时器
-    bool insert(Timer *timer);                                    // 插入定时器
-    void resetTimerfd(int timerfd, Timestamp expiration);         // 重置定时器
-    void addTimerInLoop(Timer *timer);                            // 在EventLoop中添加定时器
-    void cancelInLoop(TimerId timerId);                           // 在EventLoop中取消定时器
+    void handleRead();                                                  //  处理定时器事件
+    void reset(const std::vector<Timer *> &expired, MonotonicTime now); // 重置定时器
+    void resetTimerfd(int timerfd, MonotonicTime expiration);           // 重置定时器
+    void addTimerInLoop(Timer *timer);                                  // 在EventLoop中添加定时器
+    void cancelInLoop(TimerId timerId);                                 // 在EventLoop中取消定时器
+    void applySlack(Timer *timer);                                      // 在slack范围内调整定时器的到期时间
 
 private:
     EventLoop *loop_;                // 所属EventLoop
-    const int timerfd_;              // 定时器文件描述符
+    const bool useTimerfd_;          // 是否使用timerfd通知定时器到期
+    const int timerfd_;              // 定时器文件描述符、不使用timerfd时为-1
     Channel timerfdChannel_;         // 定时器通道
-    TimerList timers_;               // 定时器列表
-    ActiveTimerSet activeTimers_;    // 活动定时器集合
+    TimerPool pool_;                 // Timer对象池，子类析构后释放剩余的Timer
+    std::vector<Timer *> expired_;   // 本轮到期的定时器，重复使用避免每轮分配
     bool callingExpiredTimers_;      // 是否正在调用过期定时器
     ActiveTimerSet cancelingTimers_; // 取消定时器集合
+    MonotonicTime armedExpiration_;  // timerfd当前设置的到期时间，timerfd触发后失效
+    std::atomic<int64_t> defaultSlackUs_;
+
+    std::atomic<int64_t> numWakeups_;
+    std::atomic<int64_t> numTimersRun_;
+    std::atomic<int64_t> numCoalesced_;
+    std::atomic<int64_t> numTimerfdSettimes_;
+    std::atomic<int64_t> numSettimesSkipped_;
 };
@@ -1,43 +1,42 @@
 #include "Timestamp.h"
+#include "TimestampFormatter.h"
 #include <time.h>
 
 Timestamp::Timestamp(/* args */) : microSecondsSinceEpoch_(0)
 {
 }
 
-inline Timestamp::Timestamp(int64_t timeSinceEpoch) : microSecondsSinceEpoch_(timeSinceEpoch)
-{
-}
-
 Timestamp::~Timestamp()
 {
 }
 
 /**
- * @brief 获取当前时间戳
+ * @brief 获取当前时间戳，微秒精度
  * @return 返回的是TimeStamp的拷贝，不是引用
  */
 Timestamp Timestamp::now()
 {
-    // time()函数返回的是从1970年1月1日0时0分0秒到现在的秒数
-    return Timestamp(time(NULL));
+    // clock_gettime通过vDSO实现，不陷入内核
+    struct timespec ts;
+    ::clock_gettime(CLOCK_REALTIME, &ts);
+    return Timestamp(static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000);
 }
 
 /**
- * @brief 将时间戳转换为字符串、格式为"年/月/日 时:分:秒"
+ * @brief 将时间戳转换为字符串、格式为"年/月/日 时:分:秒"。使用线程局部的分钟前缀缓存
  */
 std::string Timestamp::toString() const
 {
-    char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
-    snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d",
-             tm_time->tm_year + 1900, // 年份是从1900开始的
-             tm_time->tm_mon + 1,     // 月份是从0开始的
-             tm_time->tm_mday,
-             tm_time->tm_hour,
-             tm_time->tm_min,
-             tm_time->tm_sec);
-    return buf;
+    char buf[TimestampFormatter::kMaxLen];
+    size_t len = TimestampFormatter::format(*this, TimestampFormatter::kSlash, false, buf);
+    return std::string(buf, len);
+}
+
+std::string Timestamp::toFormattedString(bool showMicroseconds) const
+{
+    char buf[TimestampFormatter::kMaxLen];
+    size_t len = TimestampFormatter::format(*this, TimestampFormatter::kCompact, showMicroseconds, buf);
+    return std::string(buf, len);
 }
 
 /**
@@ -48,3 +47,10 @@ bool Timestamp::valid() const
 {
     return microSecondsSinceEpoch_ > 0;
 }
+
+MonotonicTime MonotonicTime::now()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return MonotonicTime(static_cast<int64_t>(ts.tv_sec) * kNanoSecondsPerSecond + ts.tv_nsec);
+}
@@ -3,7 +3,8 @@
 #include <string>
 
 /**
- * @brief 时间戳类
+ * @brief 时间戳类，墙上时间(CLOCK_REALTIME)，自1970-01-01起的微秒数。
+ * 用于显示；测量耗时和定时器的到期时间使用不受时间调整影响的MonotonicTime
  */
 class Timestamp
 {
@@ -12,12 +13,14 @@ private:
 
 public:
     Timestamp();
-    explicit Timestamp(int64_t timeSinceEpoch);
+    explicit Timestamp(int64_t microSecondsSinceEpoch) : microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
     ~Timestamp();
     int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
     static const int kMicroSecondsPerSecond = 1000 * 1000; // 将秒转换为微秒
     static Timestamp now();
     std::string toString() const;
+    // 格式为"年月日 时:分:秒.微秒"，showMicroseconds为false时不带微秒
+    std::string toFormattedString(bool showMicroseconds = true) const;
     bool valid() const; // 判断时间戳是否有效
     static Timestamp invalid()
     {
@@ -46,3 +49,63 @@ inline bool operator==(Timestamp lhs, Timestamp rhs)
 {
     return lhs.microSecondsSinceEpoch() == rhs.microSecondsSinceEpoch();
 }
+
+/**
+ * @brief 两个时间戳相差的秒数
+ */
+inline double timeDifference(Timestamp high, Timestamp low)
+{
+    int64_t diff = high.microSecondsSinceEpoch() - low.microSecondsSinceEpoch();
+    return static_cast<double>(diff) / Timestamp::kMicroSecondsPerSecond;
+}
+
+/**
+ * @brief 单调时钟(CLOCK_MONOTONIC)的时间点，纳秒精度，不受系统时间调整影响，用于测量耗时和超时。
+ * clock_gettime通过vDSO调用，不陷入内核
+ */
+class MonotonicTime
+{
+private:
+    int64_t nanoSeconds_; // 自某个未指定起点(通常是开机)的纳秒数
+
+public:
+    MonotonicTime() : nanoSeconds_(0) {}
+    explicit MonotonicTime(int64_t nanoSeconds) : nanoSeconds_(nanoSeconds) {}
+
+    static const int64_t kNanoSecondsPerSecond = 1000 * 1000 * 1000;
+    static MonotonicTime now();
+
+    int64_t nanoSeconds() const { return nanoSeconds_; }
+    int64_t microSeconds() const { return nanoSeconds_ / 1000; }
+    bool valid() const { return nanoSeconds_ > 0; }
+    static MonotonicTime invalid()
+    {
+        return MonotonicTime();
+    }
+};
+
+/**
+ * @brief 单调时间点加上seconds秒
+ */
+inline MonotonicTime addTime(MonotonicTime time, double seconds)
+{
+    return MonotonicTime(time.nanoSeconds() + static_cast<int64_t>(seconds * MonotonicTime::kNanoSecondsPerSecond));
+}
+
+inline bool operator<(MonotonicTime lhs, MonotonicTime rhs)
+{
+    return lhs.nanoSeconds() < rhs.nanoSeconds();
+}
+
+inline bool operator==(MonotonicTime lhs, MonotonicTime rhs)
+{
+    return lhs.nanoSeconds() == rhs.nanoSeconds();
+}
+
+/**
+ * @brief 两个单调时间点相差的秒数
+ */
+inline double timeDifference(MonotonicTime high, MonotonicTime low)
+{
+    return static_cast<double>(high.nanoSeconds() - low.nanoSeconds()) / MonotonicTime::kNanoSecondsPerSecond;
+}
@@ -0,0 +1,130 @@
+#include "TimestampFormatter.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+namespace
+{
+    /**
+     * @brief 某个格式在当前线程中缓存的分钟前缀
+     */
+    struct MinuteCache
+    {
+        int64_t minute; // prefix对应的分钟数(自1970起)，-1表示无效
+        size_t prefixLen;
+        char prefix[TimestampFormatter::kMaxLen];
+    };
+
+    __thread MinuteCache t_minuteCache[2] = {{-1, 0, {0}}, {-1, 0, {0}}};
+
+    const char kDigitPairs[] =
+        "00010203040506070809"
+        "10111213141516171819"
+        "20212223242526272829"
+        "30313233343536373839"
+        "40414243444546474849"
+        "50515253545556575859"
+        "60616263646566676869"
+        "70717273747576777879"
+        "80818283848586878889"
+        "90919293949596979899";
+
+    // 写入两位数字，value在[0, 99]内
+    inline void writeTwoDigits(char *buf, int value)
+    {
+        memcpy(buf, kDigitPairs + value * 2, 2);
+    }
+
+    // 写入6位微秒数
+    inline void writeMicroseconds(char *buf, int value)
+    {
+        writeTwoDigits(buf + 4, value % 100);
+        value /= 100;
+        writeTwoDigits(buf + 2, value % 100);
+        writeTwoDigits(buf, value / 100);
+    }
+
+    /**
+     * @brief 重新计算分钟前缀
+     * @return 时区偏移是否是整分钟、即前缀能否在这一分钟内复用
+     */
+    bool fillPrefix(int64_t seconds, TimestampFormatter::Style style, MinuteCache *cache)
+    {
+        time_t t = static_cast<time_t>(seconds);
+        struct tm tm_time;
+        localtime_r(&t, &tm_time);
+        const char *fmt = style == TimestampFormatter::kSlash ? "%4d/%02d/%02d %02d:%02d:" : "%4d%02d%02d %02d:%02d:";
+        int len = snprintf(cache->prefix, sizeof cache->prefix, fmt,
+                           tm_time.tm_year + 1900, tm_time.tm_mon + 1, tm_time.tm_mday,
+                           tm_time.tm_hour, tm_time.tm_min);
+        cache->prefixLen = static_cast<size_t>(len);
+        return tm_time.tm_gmtoff % 60 == 0 && tm_time.tm_sec == seconds % 60;
+    }
+}
+
+size_t TimestampFormatter::format(Timestamp timestamp, Style style, bool showMicroseconds, char *buf)
+{
+    const int64_t us = timestamp.microSecondsSinceEpoch();
+    const int64_t seconds = us / Timestamp::kMicroSecondsPerSecond;
+    const int64_t minute = seconds / 60;
+
+    MinuteCache &cache = t_minuteCache[style];
+    if (cache.minute != minute)
+    {
+        cache.minute = fillPrefix(seconds, style, &cache) ? minute : -1;
+    }
+
+    size_t len = cache.prefixLen;
+    memcpy(buf, cache.prefix, len);
+    writeTwoDigits(buf + len, static_cast<int>(seconds % 60));
+    len += 2;
+    if (showMicroseconds)
+    {
+        buf[len++] = '.';
+        writeMicroseconds(buf + len, static_cast<int>(us % Timestamp::kMicroSecondsPerSecond));
+        len += 6;
+    }
+    buf[len] = '\0';
+    return len;
+}
+
+HttpDateCache::HttpDateCache()
+    : second_(-1)
+{
+    buf_[0] = '\0';
+}
+
+const char *HttpDateCache::format(Timestamp now)
+{
+    const int64_t second = now.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond;
+    if (second != second_)
+    {
+        static const char kWeekdays[7][4] = {"Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat"};
+        static const char kMonths[12][4] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                            "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+        time_t t = static_cast<time_t>(second);
+        struct tm tm_time;
+        gmtime_r(&t, &tm_time); // GMT不涉及时区，不需要localtime的锁
+        // 固定宽度，逐个字段写入："Sun, 06 Nov 1994 08:49:37 GMT"。年份限制在4位以内，长度总是kLen
+        const int year = tm_time.tm_year + 1900 < 0 ? 0 : (tm_time.tm_year + 1900 > 9999 ? 9999 : tm_time.tm_year + 1900);
+        char *p = buf_;
+        memcpy(p, kWeekdays[tm_time.tm_wday], 3);
+        memcpy(p + 3, ", ", 2);
+        writeTwoDigits(p + 5, tm_time.tm_mday);
+        p[7] = ' ';
+        memcpy(p + 8, kMonths[tm_time.tm_mon], 3);
+        p[11] = ' ';
+        writeTwoDigits(p + 12, year / 100);
+        writeTwoDigits(p + 14, year % 100);
+        p[16] = ' ';
+        writeTwoDigits(p + 17, tm_time.tm_hour);
+        p[19] = ':';
+        writeTwoDigits(p + 20, tm_time.tm_min);
+        p[22] = ':';
+        writeTwoDigits(p + 23, tm_time.tm_sec);
+        memcpy(p + 25, " GMT", 5); // 包括结尾的'\0'
+        second_ = second;
+    }
+    return buf_;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "noncopyable.h"
+#include "Timestamp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief 带线程局部缓存的时间戳格式化。
+ * 每个线程按格式缓存当前这一分钟的"年月日 时:分:"前缀，同一分钟内格式化只需要拷贝前缀、
+ * 再写入秒和微秒的数字，不调用localtime_r和snprintf；跨分钟时才重新计算前缀。
+ * 时区偏移不是整分钟时不缓存，每次都重新计算
+ */
+class TimestampFormatter : noncopyable
+{
+public:
+    enum Style
+    {
+        kSlash,   // "2026/10/19 16:53:44"，Timestamp::toString和日志使用
+        kCompact, // "20261019 16:53:44"，Timestamp::toFormattedString使用
+    };
+
+    static const int kMaxLen = 32; // 包括微秒和结尾的'\0'
+
+    /**
+     * @brief 按本地时区格式化到buf，buf至少kMaxLen字节，以'\0'结尾
+     * @param showMicroseconds 为true时追加".微秒"
+     * @return 写入的长度，不包括'\0'
+     */
+    static size_t format(Timestamp timestamp, Style style, bool showMicroseconds, char *buf);
+};
+
+/**
+ * @brief RFC 7231的HTTP日期("Sun, 06 Nov 1994 08:49:37 GMT")缓存，同一秒内直接返回上一次的结果。
+ * 不是线程安全的，每个EventLoop持有一个，只在loop线程中使用
+ */
+class HttpDateCache : noncopyable
+{
+public:
+    static const int kLen = 29; // 不包括结尾的'\0'
+
+    HttpDateCache();
+
+    /**
+     * @brief 返回now所在秒的HTTP日期，以'\0'结尾，长度为kLen。秒数变化时才重新格式化
+     */
+    const char *format(Timestamp now);
+
+private:
+    int64_t second_; // buf_对应的秒数
+    char buf_[kLen + 1];
+};
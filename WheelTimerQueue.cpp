@@ -0,0 +1,221 @@
+#include "WheelTimerQueue.h"
+#include "Timer.h"
+
+#include <algorithm>
+#include <string.h>
+
+// 最高层能表示的最大距离，更远的定时器先放在这个距离上，级联时再重新放置
+const int64_t kMaxDelta = (int64_t(1) << (WheelTimerQueue::kSlotBits * WheelTimerQueue::kLevels)) - 1;
+
+WheelTimerQueue::WheelTimerQueue(EventLoop *loop, bool useTimerfd)
+    : TimerQueue(loop, useTimerfd),
+      currentTick_(MonotonicTime::now().nanoSeconds() / kTickNs),
+      size_(0)
+{
+    memset(slots_, 0, sizeof slots_);
+    memset(bitmap_, 0, sizeof bitmap_);
+}
+
+WheelTimerQueue::~WheelTimerQueue()
+{
+}
+
+/**
+ * @brief 距离currentTick_不到256^(L+1)个tick的定时器放在第L层，槽号取到期tick的第L组8位
+ */
+void WheelTimerQueue::link(Timer *timer)
+{
+    int64_t delta = std::min(std::max<int64_t>(tickOf(timer->expiration()) - currentTick_, 0), kMaxDelta);
+    int64_t tick = currentTick_ + delta;
+    int level = 0;
+    while (level < kLevels - 1 && delta >= (int64_t(1) << (kSlotBits * (level + 1))))
+    {
+        ++level;
+    }
+    int index = static_cast<int>((tick >> (kSlotBits * level)) & kSlotMask);
+    int slot = level * kSlots + index;
+
+    timer->wheelPrev_ = nullptr;
+    timer->wheelNext_ = slots_[slot];
+    if (slots_[slot] != nullptr)
+    {
+        slots_[slot]->wheelPrev_ = timer;
+    }
+    slots_[slot] = timer;
+    timer->wheelSlot_ = slot;
+    bitmap_[level][index / 64] |= uint64_t(1) << (index % 64);
+}
+
+void WheelTimerQueue::unlink(Timer *timer)
+{
+    int slot = timer->wheelSlot_;
+    if (timer->wheelPrev_ != nullptr)
+    {
+        timer->wheelPrev_->wheelNext_ = timer->wheelNext_;
+    }
+    else
+    {
+        slots_[slot] = timer->wheelNext_;
+    }
+    if (timer->wheelNext_ != nullptr)
+    {
+        timer->wheelNext_->wheelPrev_ = timer->wheelPrev_;
+    }
+    if (slots_[slot] == nullptr)
+    {
+        int level = slot / kSlots;
+        int index = slot % kSlots;
+        bitmap_[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+    }
+    timer->wheelPrev_ = nullptr;
+    timer->wheelNext_ = nullptr;
+    timer->wheelSlot_ = -1;
+}
+
+void WheelTimerQueue::cascade(int level, int index)
+{
+    int slot = level * kSlots + index;
+    Timer *timer = slots_[slot];
+    slots_[slot] = nullptr;
+    bitmap_[level][index / 64] &= ~(uint64_t(1) << (index % 64));
+    while (timer != nullptr)
+    {
+        Timer *next = timer->wheelNext_;
+        link(timer);
+        timer = next;
+    }
+}
+
+int WheelTimerQueue::findOccupied(int level, int start) const
+{
+    const int kWords = kSlots / 64;
+    const int offset = start % 64;
+    // 多检查一次起始的字，覆盖绕回来之后start之前的槽
+    for (int i = 0; i <= kWords; ++i)
+    {
+        int word = (start / 64 + i) % kWords;
+        uint64_t bits = bitmap_[level][word];
+        if (i == 0)
+        {
+            bits &= ~uint64_t(0) << offset;
+        }
+        else if (i == kWords)
+        {
+            bits &= (uint64_t(1) << offset) - 1;
+        }
+        if (bits != 0)
+        {
+            int index = word * 64 + __builtin_ctzll(bits);
+            return (index - start + kSlots) & kSlotMask;
+        }
+    }
+    return -1;
+}
+
+MonotonicTime WheelTimerQueue::nextExpiration() const
+{
+    if (size_ == 0)
+    {
+        return MonotonicTime::invalid();
+    }
+
+    int64_t best = INT64_MAX;
+    int distance = findOccupied(0, static_cast<int>(currentTick_ & kSlotMask));
+    if (distance >= 0)
+    {
+        best = currentTick_ + distance;
+    }
+    for (int level = 1; level < kLevels; ++level)
+    {
+        int shift = kSlotBits * level;
+        int64_t window = currentTick_ >> shift;
+        int start = static_cast<int>(window & kSlotMask);
+        // 当前窗口的槽在currentTick_正好是窗口起点时还没有级联，否则要等转完一圈
+        bool pending = (currentTick_ & ((int64_t(1) << shift) - 1)) == 0;
+        distance = pending ? findOccupied(level, start) : findOccupied(level, (start + 1) & kSlotMask);
+        if (distance >= 0)
+        {
+            int64_t windows = pending ? distance : distance + 1;
+            best = std::min(best, (window + windows) << shift);
+        }
+    }
+    return MonotonicTime(best * kTickNs);
+}
+
+/**
+ * @return 是否最早到期的定时器改变
+ */
+bool WheelTimerQueue::insert(Timer *timer)
+{
+    MonotonicTime earliest = nextExpiration();
+    link(timer);
+    ++size_;
+    return !earliest.valid() || tickOf(timer->expiration()) * kTickNs < earliest.nanoSeconds();
+}
+
+bool WheelTimerQueue::remove(Timer *timer)
+{
+    if (timer->wheelSlot_ < 0)
+    {
+        return false;
+    }
+    unlink(timer);
+    --size_;
+    return true;
+}
+
+/**
+ * @brief 逐个tick推进到now，每转完一圈先级联高层的槽，再取出第0层当前槽中的定时器。
+ * 第0层为空时直接跳到下一个级联点
+ */
+void WheelTimerQueue::getExpired(MonotonicTime now, std::vector<Timer *> *expired)
+{
+    const int64_t target = now.nanoSeconds() / kTickNs;
+    while (currentTick_ <= target)
+    {
+        if (size_ == 0)
+        {
+            currentTick_ = target + 1;
+            break;
+        }
+
+        int index = static_cast<int>(currentTick_ & kSlotMask);
+        if (index == 0)
+        {
+            for (int level = 1; level < kLevels; ++level)
+            {
+                int upper = static_cast<int>((currentTick_ >> (kSlotBits * level)) & kSlotMask);
+                cascade(level, upper);
+                if (upper != 0)
+                {
+                    break;
+                }
+            }
+        }
+
+        Timer *timer = slots_[index];
+        slots_[index] = nullptr;
+        bitmap_[0][index / 64] &= ~(uint64_t(1) << (index % 64));
+        while (timer != nullptr)
+        {
+            Timer *next = timer->wheelNext_;
+            timer->wheelPrev_ = nullptr;
+            timer->wheelNext_ = nullptr;
+            timer->wheelSlot_ = -1;
+            --size_;
+            expired->push_back(timer);
+            timer = next;
+        }
+        ++currentTick_;
+
+        bool level0Empty = true;
+        for (uint64_t bits : bitmap_[0])
+        {
+            level0Empty = level0Empty && bits == 0;
+        }
+        if (level0Empty)
+        {
+            currentTick_ = std::min(target + 1, (currentTick_ + kSlotMask) & ~int64_t(kSlotMask));
+        }
+    }
+}
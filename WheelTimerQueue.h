@@ -0,0 +1,49 @@
+#pragma once
+#include "TimerQueue.h"
+
+#include <stdint.h>
+#include <vector>
+
+/**
+ * @brief 分层时间轮。tick为1ms，5层、每层256个槽，覆盖2^40ms(约34年)，更远的定时器放在最高层并在级联时重新放置。
+ * 第0层的槽对应单个tick，第L层的槽对应256^L个tick，当低层转完一圈时把高层对应槽中的定时器重新放到低层(级联)。
+ * 插入、取消都是O(1)，到期处理均摊O(1)。
+ *
+ * 定时器在到期时间向上取整到tick的时刻触发，不会早于到期时间，最多晚1ms；同一个tick内的定时器不保证先后顺序。
+ */
+class WheelTimerQueue : public TimerQueue
+{
+public:
+    static const int kLevels = 5;
+    static const int kSlotBits = 8;
+    static const int kSlots = 1 << kSlotBits;
+    static const int kSlotMask = kSlots - 1;
+    static const int64_t kTickUs = 1000; // 一个tick的微秒数
+
+    WheelTimerQueue(EventLoop *loop, bool useTimerfd);
+    ~WheelTimerQueue() override;
+
+    /**
+     * @brief 最早非空的第0层槽的tick与高层最早的级联时刻中较早的一个
+     */
+    MonotonicTime nextExpiration() const override;
+
+protected:
+    bool insert(Timer *timer) override;
+    bool remove(Timer *timer) override;
+    void getExpired(MonotonicTime now, std::vector<Timer *> *expired) override;
+
+private:
+    static const int64_t kTickNs = kTickUs * 1000;
+    static int64_t tickOf(MonotonicTime when) { return (when.nanoSeconds() + kTickNs - 1) / kTickNs; }
+
+    void link(Timer *timer);                      // 按到期tick放入对应的槽
+    void unlink(Timer *timer);                    // 从所在的槽中摘下
+    void cascade(int level, int index);           // 把高层槽中的定时器重新放置
+    int findOccupied(int level, int start) const; // 从start开始循环查找第一个非空槽，返回距离
+
+    Timer *slots_[kLevels * kSlots];        // 每个槽是一个侵入式双向链表
+    uint64_t bitmap_[kLevels][kSlots / 64]; // 非空槽的位图，用于快速查找下一个到期的槽
+    int64_t currentTick_;                   // 下一个要处理的tick
+    size_t size_;                           // 定时器总数
+};
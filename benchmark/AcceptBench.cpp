@@ -0,0 +1,100 @@
+// mainLoop统一accept(每次可读事件accept一个/一批)与每个loop各自SO_REUSEPORT监听几种方式的建连速率对比
+// 用法: accept_bench [subloop数=4] [客户端线程数=4] [每种方式的测试秒数=5] [一次accept的连接数=32]
+// 每种方式启动一个什么都不做的服务器，客户端线程循环connect后立即用RST关闭(SO_LINGER为0，不留TIME_WAIT，
+// 不会耗尽本地端口)，统计服务器每秒建立的连接数
+#include "BenchUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static std::atomic<long> g_established(0);
+
+static void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        g_established.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief 客户端线程：connect成功后立即RST关闭，直到截止时间
+ * @return 成功connect的次数
+ */
+static long connectStorm(uint16_t port, std::chrono::steady_clock::time_point deadline)
+{
+    InetAddr serverAddr(port);
+    long connects = 0;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (::connect(fd, serverAddr.getSockaddr(), sizeof(sockaddr_in)) == 0)
+        {
+            ++connects;
+        }
+        linger lg = {1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        ::close(fd);
+    }
+    return connects;
+}
+
+/**
+ * @brief 在独立的loop线程中运行服务器，多个客户端线程同时建连
+ * @return 服务器每秒建立的连接数
+ */
+static double runMode(TcpServer::Option option, int acceptBatch, uint16_t port, int subLoops, int clients, int seconds)
+{
+    long connects = 0;
+    long established = 0;
+    {
+        // 析构时等500ms让服务器处理完连接关闭
+        BenchServer server(port, "AcceptServer", [=](TcpServer *s)
+                           {
+            s->setThreadNum(subLoops);
+            s->setAcceptBatch(acceptBatch);
+            s->setConnectionCallback(onConnection);
+            s->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); }); },
+                           option, 500);
+        ::usleep(100 * 1000); // 等各个loop开始监听
+
+        g_established = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+        std::vector<std::future<long>> results;
+        for (int i = 0; i < clients; ++i)
+        {
+            results.push_back(std::async(std::launch::async, connectStorm, port, deadline));
+        }
+        for (std::future<long> &r : results)
+        {
+            connects += r.get();
+        }
+        established = g_established.load();
+    }
+
+    benchResult("%s batch=%d: connects=%ld established=%ld\n",
+                option == TcpServer::kReusePortPerLoop ? "reuseport per loop" : "main loop accept", acceptBatch,
+                connects, established);
+    return static_cast<double>(established) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    int subLoops = argc > 1 ? atoi(argv[1]) : 4;
+    int clients = argc > 2 ? atoi(argv[2]) : 4;
+    int seconds = argc > 3 ? atoi(argv[3]) : 5;
+    int batch = argc > 4 ? atoi(argv[4]) : 32;
+
+    double single = runMode(TcpServer::kNoReusePort, 1, 9986, subLoops, clients, seconds);
+    double batched = runMode(TcpServer::kNoReusePort, batch, 9987, subLoops, clients, seconds);
+    double perLoop = runMode(TcpServer::kReusePortPerLoop, batch, 9988, subLoops, clients, seconds);
+
+    benchResult("subloops=%d clients=%d connections/sec: main loop accept one=%.0f batch %d=%.0f, reuseport per loop=%.0f\n",
+                subLoops, clients, single, batch, batched, perLoop);
+    return 0;
+}
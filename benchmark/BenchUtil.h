@@ -0,0 +1,136 @@
+#pragma once
+// 各个性能测试程序共用的部分：结果输出、在独立loop线程中运行的服务器、ping-pong客户端
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../TcpServer.h"
+#include "../noncopyable.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @brief 输出一行测试结果。日志输出在stdout上，结果统一输出到stderr，重定向stdout就只剩结果
+ */
+inline void benchResult(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+inline void benchResult(const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+}
+
+/**
+ * @brief 在独立的loop线程中运行一个TcpServer。构造时在loop线程中创建服务器、调用setup设置回调后启动；
+ * 析构时先等drainMs让服务器处理完连接关闭，再在loop线程中销毁TcpServer
+ */
+class BenchServer : noncopyable
+{
+public:
+    using Setup = std::function<void(TcpServer *)>;
+
+    BenchServer(uint16_t port, const std::string &name, const Setup &setup,
+                TcpServer::Option option = TcpServer::kNoReusePort, int drainMs = 200)
+        : loop_(loopThread_.startLoop()),
+          drainMs_(drainMs)
+    {
+        std::promise<void> started;
+        loop_->runInLoop([&]()
+                         {
+            server_.reset(new TcpServer(loop_, InetAddr(port), name, option));
+            setup(server_.get());
+            server_->start();
+            started.set_value(); });
+        started.get_future().wait();
+    }
+
+    ~BenchServer()
+    {
+        ::usleep(drainMs_ * 1000);
+        std::promise<void> stopped;
+        loop_->runInLoop([&]()
+                         {
+            server_.reset();
+            stopped.set_value(); });
+        stopped.get_future().wait();
+    }
+
+    EventLoop *loop() const { return loop_; }
+
+private:
+    EventLoopThread loopThread_;
+    EventLoop *loop_;
+    std::unique_ptr<TcpServer> server_; // 只在loop线程中创建和销毁
+    const int drainMs_;
+};
+
+/**
+ * @brief echo客户端：每个连接保持一个在途消息，收到完整回包后立即发下一个，用poll驱动全部连接
+ * @return 总往返次数
+ */
+inline long runEchoClients(uint16_t port, int connections, int seconds, size_t msgSize)
+{
+    std::vector<pollfd> fds(connections);
+    std::vector<size_t> received(connections, 0);
+    std::string msg(msgSize, 'x');
+    std::vector<char> buf(msgSize);
+
+    InetAddr serverAddr(port);
+    for (int i = 0; i < connections; ++i)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, serverAddr.getSockaddr(), sizeof(sockaddr_in)) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        fds[i].fd = fd;
+        fds[i].events = POLLIN;
+        ssize_t n = ::write(fd, msg.data(), msg.size());
+        (void)n;
+    }
+
+    long roundTrips = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        int ready = ::poll(fds.data(), fds.size(), 100);
+        for (int i = 0; i < connections && ready > 0; ++i)
+        {
+            if (!(fds[i].revents & POLLIN))
+            {
+                continue;
+            }
+            --ready;
+            ssize_t n = ::read(fds[i].fd, buf.data(), msgSize - received[i]);
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection %d closed by server\n", i);
+                exit(1);
+            }
+            received[i] += n;
+            if (received[i] == msgSize)
+            {
+                received[i] = 0;
+                ++roundTrips;
+                n = ::write(fds[i].fd, msg.data(), msg.size());
+            }
+        }
+    }
+
+    for (pollfd &p : fds)
+    {
+        ::close(p.fd);
+    }
+    return roundTrips;
+}
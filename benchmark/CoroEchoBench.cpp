@@ -0,0 +1,74 @@
+// 协程与回调两种写法的echo服务器对比
+// 用法: coro_echo_bench [连接数=16] [每种模式的测试秒数=5] [消息大小=64]
+// 同一进程内依次启动回调版和协程版echo服务器（各自一个loop线程），
+// 客户端线程用poll驱动全部连接做ping-pong，统计每秒往返次数。
+#include "BenchUtil.h"
+#include "../coroutine/Task.h"
+#include "../coroutine/CoConnection.h"
+
+#include <cstdlib>
+#include <string>
+
+static Task<void> echoSession(TcpConnectionPtr conn)
+{
+    CoConnection c(conn);
+    while (true)
+    {
+        std::string data = co_await c.readSome();
+        if (data.empty())
+        {
+            break;
+        }
+        if (!co_await c.write(data))
+        {
+            break;
+        }
+    }
+}
+
+static void onCallbackMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+static void onCoroutineConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        // CoConnection会替换掉连接上的回调，TcpConnection调用的是回调的副本，当前这个回调可以正常返回
+        co_spawn(echoSession(conn));
+    }
+}
+
+/**
+ * @brief 在独立的loop线程中运行一种echo服务器并压测
+ */
+static void runMode(const char *mode, bool coroutine, uint16_t port, int connections, int seconds, size_t msgSize)
+{
+    BenchServer server(port, mode, [coroutine](TcpServer *s)
+                       {
+        if (coroutine)
+        {
+            s->setConnectionCallback(onCoroutineConnection);
+        }
+        else
+        {
+            s->setConnectionCallback([](const TcpConnectionPtr &) {});
+            s->setMessageCallback(onCallbackMessage);
+        } });
+
+    long roundTrips = runEchoClients(port, connections, seconds, msgSize);
+    benchResult("%-10s connections=%d msgsize=%zu round trips/sec=%.0f\n",
+                mode, connections, msgSize, static_cast<double>(roundTrips) / seconds);
+}
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    size_t msgSize = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 64;
+
+    runMode("callback", false, 9981, connections, seconds, msgSize);
+    runMode("coroutine", true, 9982, connections, seconds, msgSize);
+    return 0;
+}
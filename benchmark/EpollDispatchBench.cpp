@@ -0,0 +1,139 @@
+// 大量空闲连接中少量热点连接时EpollPoller的事件分发开销
+// 用法: epoll_dispatch_bench [空闲连接数=100000] [热点连接数=10000] [总事件数=2000000]
+// 一个loop中注册idle+hot对socketpair，空闲的从不写入；热点的读回调读出1字节后再向自己写入1字节，
+// 每轮epoll_wait都返回全部热点连接，统计每个事件的平均耗时。fd不够时按比例缩小连接数。
+#include "BenchUtil.h"
+#include "../EventLoop.h"
+#include "../Channel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Pairs
+{
+    std::vector<int> readFds;
+    std::vector<int> writeFds;
+    std::vector<std::unique_ptr<Channel>> channels;
+};
+
+struct HotState
+{
+    EventLoop *loop;
+    Pairs *pairs;
+    long handled;
+    long total;
+};
+
+static void onHotReadable(HotState *state, int i)
+{
+    char c;
+    ssize_t n = ::read(state->pairs->readFds[i], &c, 1);
+    if (++state->handled >= state->total)
+    {
+        state->loop->quit();
+        return;
+    }
+    n = ::write(state->pairs->writeFds[i], "e", 1);
+    (void)n;
+}
+
+static void addPairs(EventLoop *loop, Pairs *pairs, int count, HotState *hot)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        int sv[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+        {
+            perror("socketpair");
+            exit(1);
+        }
+        int index = static_cast<int>(pairs->readFds.size());
+        pairs->readFds.push_back(sv[0]);
+        pairs->writeFds.push_back(sv[1]);
+        Channel *channel = new Channel(loop, sv[0]);
+        if (hot != nullptr)
+        {
+            channel->setReadCallBack(std::bind(onHotReadable, hot, index));
+        }
+        channel->enableReading();
+        pairs->channels.emplace_back(channel);
+    }
+}
+
+static void closePairs(Pairs *pairs)
+{
+    for (size_t i = 0; i < pairs->channels.size(); ++i)
+    {
+        pairs->channels[i]->disableAll();
+        pairs->channels[i]->remove();
+        ::close(pairs->readFds[i]);
+        ::close(pairs->writeFds[i]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int idle = argc > 1 ? atoi(argv[1]) : 100000;
+    int hot = argc > 2 ? atoi(argv[2]) : 10000;
+    long total = argc > 3 ? atol(argv[3]) : 2000000;
+
+    // 尽量把fd上限提高到硬限制，每对socketpair占用两个fd
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &rl);
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    long maxPairs = static_cast<long>(rl.rlim_cur / 2) - 16;
+    if (idle + hot > maxPairs)
+    {
+        double scale = static_cast<double>(maxPairs) / (idle + hot);
+        idle = static_cast<int>(idle * scale);
+        hot = std::max(1, static_cast<int>(hot * scale));
+    }
+
+    double nsPerEvent = 0;
+    long iterations = 0;
+    {
+        EventLoop loop;
+        Pairs idlePairs;
+        Pairs hotPairs;
+        HotState state = {&loop, &hotPairs, 0, total};
+        // 空闲连接和热点连接交错注册，热点channel在堆上不连续
+        for (int i = 0; i < std::max(idle, hot); ++i)
+        {
+            if (i < idle)
+            {
+                addPairs(&loop, &idlePairs, 1, nullptr);
+            }
+            if (i < hot)
+            {
+                addPairs(&loop, &hotPairs, 1, &state);
+            }
+        }
+        for (int fd : hotPairs.writeFds)
+        {
+            ssize_t n = ::write(fd, "e", 1);
+            (void)n;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        loop.loop();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        nsPerEvent = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total;
+        iterations = total / hot;
+
+        closePairs(&idlePairs);
+        closePairs(&hotPairs);
+    }
+
+    benchResult("idle=%d hot=%d events=%ld iterations~%ld  %.0f ns/event\n",
+                idle, hot, total, iterations, nsPerEvent);
+    return 0;
+}
@@ -0,0 +1,148 @@
+// 流式日志(LogStream/LOGS_*)与snprintf的对比
+// 用法: log_stream_bench [次数=2000000]
+// 1. 单个值的转换：整数、十六进制、浮点数分别用LogStream的转换函数和snprintf，
+//    同时用随机值检查结果与snprintf是否一致(浮点数与"%.12g"比较)
+// 2. 整行日志：同一条日志分别用LOG_INFO(vsnprintf)和LOGS_INFO格式化，输出函数什么都不做，只统计格式化的开销
+// 结果输出到stderr
+#include "../InetAddr.h"
+#include "../LogStream.h"
+#include "../Logger.h"
+#include "../Timestamp.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+static void nullOutput(int, const char *, size_t)
+{
+}
+
+static double nsPerOp(std::chrono::steady_clock::time_point start, long n)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+}
+
+/**
+ * @brief 随机值的转换结果与snprintf比较，返回不一致的个数
+ */
+static long checkAgainstSnprintf(long n)
+{
+    std::mt19937_64 rng(42);
+    long mismatches = 0;
+    char expected[64], actual[64];
+    for (long i = 0; i < n; ++i)
+    {
+        const long long v = static_cast<long long>(rng()) >> (rng() % 64);
+        snprintf(expected, sizeof expected, "%lld", v);
+        actual[LogStream::convert(actual, v)] = '\0';
+        mismatches += strcmp(expected, actual) != 0;
+
+        const uint64_t u = rng() >> (rng() % 64);
+        snprintf(expected, sizeof expected, "0x%llx", static_cast<unsigned long long>(u));
+        actual[LogStream::convertHex(actual, u)] = '\0';
+        mismatches += strcmp(expected, actual) != 0;
+
+        // 覆盖定点格式的整个范围：1e-5到1e10。短小数会落在舍入的边界(第13位有效数字是5)上，
+        // 完整精度的随机值检查第13位之后的部分是否影响舍入，两者都要求与snprintf逐字相同
+        const double sign = rng() % 2 ? -1 : 1;
+        const double doubles[2] = {
+            sign * static_cast<double>(rng() % 10000000000000ULL) * pow(10.0, static_cast<int>(rng() % 16) - 17),
+            sign * pow(10.0, std::uniform_real_distribution<double>(-5, 10)(rng))};
+        for (double d : doubles)
+        {
+            snprintf(expected, sizeof expected, "%.12g", d);
+            actual[LogStream::convertDouble(actual, d)] = '\0';
+            if (strcmp(expected, actual) != 0 && ++mismatches <= 5)
+            {
+                fprintf(stderr, "  double mismatch: %.17g snprintf=%s LogStream=%s\n", d, expected, actual);
+            }
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    const long n = argc > 1 ? atol(argv[1]) : 2000000;
+    char buf[64];
+    volatile size_t sink = 0;
+
+    std::vector<long long> ints(1024);
+    std::vector<double> doubles(1024);
+    std::mt19937_64 rng(7);
+    for (size_t i = 0; i < ints.size(); ++i)
+    {
+        ints[i] = static_cast<long long>(rng() >> (rng() % 48));
+        doubles[i] = static_cast<double>(rng() % 100000000) / 1000.0;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += snprintf(buf, sizeof buf, "%lld", ints[i & 1023]);
+    }
+    double snprintfInt = nsPerOp(start, n);
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += LogStream::convert(buf, ints[i & 1023]);
+    }
+    double streamInt = nsPerOp(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += snprintf(buf, sizeof buf, "0x%llx", static_cast<unsigned long long>(ints[i & 1023]));
+    }
+    double snprintfHex = nsPerOp(start, n);
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += LogStream::convertHex(buf, static_cast<uint64_t>(ints[i & 1023]));
+    }
+    double streamHex = nsPerOp(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += snprintf(buf, sizeof buf, "%.12g", doubles[i & 1023]);
+    }
+    double snprintfDouble = nsPerOp(start, n);
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        sink += LogStream::convertDouble(buf, doubles[i & 1023]);
+    }
+    double streamDouble = nsPerOp(start, n);
+
+    fprintf(stderr, "integer  snprintf %6.1f ns  LogStream %6.1f ns\n", snprintfInt, streamInt);
+    fprintf(stderr, "hex      snprintf %6.1f ns  LogStream %6.1f ns\n", snprintfHex, streamHex);
+    fprintf(stderr, "double   snprintf %6.1f ns  LogStream %6.1f ns\n", snprintfDouble, streamDouble);
+    fprintf(stderr, "mismatches against snprintf: %ld of %ld values\n", checkAgainstSnprintf(n / 4), n / 4 * 4);
+
+    // 整行日志，时间戳的格式化两者相同
+    Logger::setOutput(nullOutput);
+    const std::string name("conn-127.0.0.1:8000#42");
+    const InetAddr peer(54321, "10.1.2.3");
+    const long lines = n / 4;
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < lines; ++i)
+    {
+        LOG_INFO("%s recv %ld bytes from %s in %.3f ms, events=0x%x", name.c_str(), i, peer.toIpPort().c_str(),
+                 doubles[i & 1023], static_cast<unsigned>(i));
+    }
+    double printfLine = nsPerOp(start, lines);
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < lines; ++i)
+    {
+        LOGS_INFO << name << " recv " << i << " bytes from " << peer << " in " << doubles[i & 1023]
+                  << " ms, events=" << LogHex(i);
+    }
+    double streamLine = nsPerOp(start, lines);
+    Logger::setOutput(nullptr);
+    fprintf(stderr, "log line LOG_INFO %6.1f ns  LOGS_INFO %6.1f ns\n", printfLine, streamLine);
+    return sink == 0;
+}
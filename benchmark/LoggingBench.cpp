@@ -0,0 +1,226 @@
+// 同步日志与异步日志(AsyncLogging)的对比
+// 用法: logging_bench [每个线程的日志条数=200000] [线程数=4] [往返次数=20000] > /dev/null
+// 1. 吞吐：多个线程同时调用LOG_INFO，统计每秒写出的行数。输出方式分别为
+//    stdout(默认，建议把stdout重定向到文件或/dev/null)、加锁fwrite到文件、AsyncLogging写滚动文件
+//    (每线程的环写满时分别等待(async-block)和丢弃(async-drop)，后者同时输出丢弃的条数)
+// 2. loop延迟：一个loop线程通过socketpair做ping-pong，poll/updateChannel路径上本身就有LOG_INFO，
+//    统计每次往返的平均和p99延迟
+// 3. 单次调用的开销：同一条日志分别用LOG_INFO(调用线程格式化)和LOGB_INFO(只保存格式id和参数)写入AsyncLogging，
+//    只统计调用线程的时间，不包括后端格式化和写文件
+// 日志文件写在/tmp下，结果输出到stderr
+#include "../AsyncLogging.h"
+#include "../BinaryLog.h"
+#include "../Channel.h"
+#include "../EventLoop.h"
+#include "../EventLoopThread.h"
+#include "../Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static FILE *g_syncFile = nullptr;
+
+static void syncFileOutput(int, const char *msg, size_t len)
+{
+    fwrite(msg, 1, len, g_syncFile); // stdio内部加锁
+}
+
+static void syncFileFlush()
+{
+    fflush(g_syncFile);
+}
+
+static void nullOutput(int, const char *, size_t)
+{
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief threads个线程各写n条日志，返回每秒的行数
+ */
+static double throughput(int threads, long n)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([n, t]() {
+            for (long i = 0; i < n; ++i)
+            {
+                LOG_INFO("logging bench thread=%d seq=%ld payload=%s", t, i, "abcdefghijklmnopqrstuvwxyz");
+            }
+        });
+    }
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    // 计入把日志真正写出去的时间
+    Logger::flush();
+    return static_cast<double>(threads) * n / secondsSince(start);
+}
+
+/**
+ * @brief loop线程中回显1字节，当前线程发送并等待回显，返回每次往返的延迟(微秒)
+ */
+static void pingPong(long rounds, double *avgUs, double *p99Us)
+{
+    int sv[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+    {
+        perror("socketpair");
+        exit(1);
+    }
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    Channel channel(loop, sv[1]);
+    channel.setReadCallBack([&sv](Timestamp) {
+        char c;
+        if (::read(sv[1], &c, 1) == 1)
+        {
+            ssize_t n = ::write(sv[1], &c, 1);
+            (void)n;
+        }
+    });
+    loop->runInLoop([&channel]() { channel.enableReading(); });
+
+    std::vector<double> samples;
+    samples.reserve(rounds);
+    char c = 'p';
+    for (long i = 0; i < rounds; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        ssize_t n = ::write(sv[0], &c, 1);
+        n = ::read(sv[0], &c, 1);
+        (void)n;
+        samples.push_back(secondsSince(start) * 1e6);
+    }
+    double sum = 0;
+    for (double s : samples)
+    {
+        sum += s;
+    }
+    std::sort(samples.begin(), samples.end());
+    *avgUs = sum / rounds;
+    *p99Us = samples[rounds * 99 / 100];
+
+    // channel先于EventLoopThread析构，等loop线程把它移除之后再返回
+    std::promise<void> removed;
+    loop->runInLoop([&channel, &removed]() {
+        channel.disableAll();
+        channel.remove();
+        removed.set_value();
+    });
+    removed.get_future().wait();
+    ::close(sv[0]);
+    ::close(sv[1]);
+}
+
+/**
+ * @brief 单线程调用n次，返回每次调用的纳秒数。
+ * 每写kBatch条flush一次(不计时)，环不会写满，也不会唤醒后端和调用线程抢CPU
+ */
+static void callLatency(long n, double *textNs, double *binaryNs, uint64_t *dropped)
+{
+    const long kBatch = 10000;
+    AsyncLogging async("/tmp/logging_bench_latency", 500 * 1000 * 1000, 3, 4 * 1024 * 1024);
+    async.start();
+    async.install();
+    const std::string payload("abcdefghijklmnopqrstuvwxyz");
+
+    double textSeconds = 0, binarySeconds = 0;
+    for (long done = 0; done < n; done += kBatch)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (long i = done; i < done + kBatch; ++i)
+        {
+            LOG_INFO("logging bench seq=%ld ratio=%.3f payload=%s", i, i * 0.5, payload.c_str());
+        }
+        textSeconds += secondsSince(start);
+        async.flush();
+
+        start = std::chrono::steady_clock::now();
+        for (long i = done; i < done + kBatch; ++i)
+        {
+            LOGB_INFO("logging bench seq=%ld ratio=%.3f payload=%s", i, i * 0.5, payload.c_str());
+        }
+        binarySeconds += secondsSince(start);
+        async.flush();
+    }
+    const long calls = (n + kBatch - 1) / kBatch * kBatch;
+    *textNs = textSeconds * 1e9 / calls;
+    *binaryNs = binarySeconds * 1e9 / calls;
+
+    *dropped = async.droppedMessages();
+    Logger::setOutput(nullptr);
+    Logger::setFlush(nullptr);
+}
+
+int main(int argc, char *argv[])
+{
+    long n = argc > 1 ? atol(argv[1]) : 200000;
+    int threads = argc > 2 ? atoi(argv[2]) : 4;
+    long rounds = argc > 3 ? atol(argv[3]) : 20000;
+
+    const char *modes[] = {"stdout", "sync-file", "async-block", "async-drop", "null"};
+    for (const char *mode : modes)
+    {
+        std::string name(mode);
+        AsyncLogging *async = nullptr;
+        if (name == "sync-file")
+        {
+            g_syncFile = fopen("/tmp/logging_bench_sync.log", "w");
+            Logger::setOutput(syncFileOutput);
+            Logger::setFlush(syncFileFlush);
+        }
+        else if (name == "async-block" || name == "async-drop")
+        {
+            async = new AsyncLogging("/tmp/logging_bench_async", 500 * 1000 * 1000);
+            async->setOverflowPolicy(name == "async-block" ? AsyncLogging::kBlock : AsyncLogging::kDrop);
+            async->start();
+            async->install();
+        }
+        else if (name == "null")
+        {
+            Logger::setOutput(nullOutput);
+        }
+
+        double linesPerSec = throughput(threads, n);
+        double avgUs = 0, p99Us = 0;
+        pingPong(rounds, &avgUs, &p99Us);
+        fprintf(stderr, "%-11s %4d threads  %10.0f lines/s   ping-pong avg=%6.1f us  p99=%6.1f us",
+                mode, threads, linesPerSec, avgUs, p99Us);
+        if (async != nullptr)
+        {
+            fprintf(stderr, "  dropped=%llu", static_cast<unsigned long long>(async->droppedMessages()));
+        }
+        fprintf(stderr, "\n");
+
+        Logger::setOutput(nullptr);
+        Logger::setFlush(nullptr);
+        delete async;
+        if (g_syncFile != nullptr)
+        {
+            fclose(g_syncFile);
+            g_syncFile = nullptr;
+        }
+    }
+
+    double textNs = 0, binaryNs = 0;
+    uint64_t dropped = 0;
+    callLatency(std::min(n, 1000000L), &textNs, &binaryNs, &dropped);
+    fprintf(stderr, "per call into async:  LOG_INFO %6.1f ns   LOGB_INFO %6.1f ns  dropped=%llu\n",
+            textNs, binaryNs, static_cast<unsigned long long>(dropped));
+    return 0;
+}
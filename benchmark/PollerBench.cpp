@@ -0,0 +1,149 @@
+// epoll与poll两种Poller的对比
+// 用法: poller_bench [每组测试的事件数=100000]
+// 与libevent的bench类似：创建n对socketpair，每个读回调读出1字节后写入下一对socketpair，
+// 同时有active个"令牌"在环上传递，统计每个事件的平均耗时。
+// churn=1时每个读回调额外做一次enableWriting/disableWriting，模拟TcpConnection的写事件开关，
+// 此时epoll每个事件多两次epoll_ctl，而poll只修改数组。
+#include "BenchUtil.h"
+#include "../EventLoop.h"
+#include "../Channel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Ring
+{
+    std::vector<int> readFds;
+    std::vector<int> writeFds;
+    std::vector<std::unique_ptr<Channel>> channels;
+    long handled;
+    long total;
+    bool churn;
+};
+
+static void onReadable(EventLoop *loop, Ring *ring, int i)
+{
+    char c;
+    ssize_t n = ::read(ring->readFds[i], &c, 1);
+    (void)n;
+    if (ring->churn)
+    {
+        ring->channels[i]->enableWriting();
+        ring->channels[i]->disableWriting();
+    }
+    if (++ring->handled >= ring->total)
+    {
+        loop->quit();
+        return;
+    }
+    int next = (i + 1) % static_cast<int>(ring->writeFds.size());
+    n = ::write(ring->writeFds[next], "e", 1);
+}
+
+/**
+ * @return 每个事件的平均耗时(ns)
+ */
+static double runOnce(bool usePoll, int numFds, int active, bool churn, long total)
+{
+    if (usePoll)
+    {
+        ::setenv("MUDUO_USE_POLL", "1", 1);
+    }
+    else
+    {
+        ::unsetenv("MUDUO_USE_POLL");
+    }
+
+    double nsPerEvent = 0;
+    {
+        EventLoop loop;
+        Ring ring;
+        ring.handled = 0;
+        ring.total = total;
+        ring.churn = churn;
+        for (int i = 0; i < numFds; ++i)
+        {
+            int sv[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) < 0)
+            {
+                perror("socketpair");
+                exit(1);
+            }
+            ring.readFds.push_back(sv[0]);
+            ring.writeFds.push_back(sv[1]);
+            Channel *channel = new Channel(&loop, sv[0]);
+            channel->setReadCallBack(std::bind(onReadable, &loop, &ring, i));
+            channel->enableReading();
+            ring.channels.emplace_back(channel);
+        }
+        // 放入active个均匀分布的令牌
+        for (int i = 0; i < active; ++i)
+        {
+            ssize_t n = ::write(ring.writeFds[i * numFds / active], "e", 1);
+            (void)n;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        loop.loop();
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        nsPerEvent = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / total;
+
+        for (int i = 0; i < numFds; ++i)
+        {
+            ring.channels[i]->disableAll();
+            ring.channels[i]->remove();
+            ::close(ring.readFds[i]);
+            ::close(ring.writeFds[i]);
+        }
+    }
+    return nsPerEvent;
+}
+
+int main(int argc, char *argv[])
+{
+    long total = argc > 1 ? atol(argv[1]) : 100000;
+
+    // 每对socketpair占用两个fd
+    struct rlimit rl;
+    ::getrlimit(RLIMIT_NOFILE, &rl);
+    int maxFds = static_cast<int>(rl.rlim_cur / 2) - 16;
+
+    const int fdCounts[] = {4, 16, 64, 256, 1024, 4096};
+    const int actives[] = {1, 16, 256};
+    std::vector<std::string> results;
+    for (int churn = 0; churn <= 1; ++churn)
+    {
+        for (int numFds : fdCounts)
+        {
+            if (numFds > maxFds)
+            {
+                continue;
+            }
+            for (int active : actives)
+            {
+                if (active > numFds)
+                {
+                    continue;
+                }
+                double epollNs = runOnce(false, numFds, active, churn, total);
+                double pollNs = runOnce(true, numFds, active, churn, total);
+                char line[128];
+                snprintf(line, sizeof line, "fds=%-5d active=%-4d churn=%d  epoll=%8.0f ns/event  poll=%8.0f ns/event",
+                         numFds, active, churn, epollNs, pollNs);
+                results.push_back(line);
+            }
+        }
+    }
+    for (const std::string &line : results)
+    {
+        benchResult("%s\n", line.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,67 @@
+// 不同Poller后端下echo服务器的对比(epoll/poll/io_uring就绪通知/io_uring完成模式)
+// 用法: poller_echo_bench [连接数=16] [每种后端的测试秒数=5] [消息大小=64]
+// 每种后端依次启动一个echo服务器（独立的loop线程，后端由环境变量在创建loop前选择），
+// 客户端线程用poll驱动全部连接做ping-pong，统计每秒往返次数，epoll后端额外统计每个请求的epoll_ctl次数。
+// 消息较大(超过socket发送缓冲区)时TcpConnection会开关写事件，可以观察epoll_ctl合并的效果。
+#include "BenchUtil.h"
+#include "../EpollPoller.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+static void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+/**
+ * @brief 用指定的环境变量选择Poller后端，在独立的loop线程中运行echo服务器并压测
+ * @param env 选择后端的环境变量，nullptr表示默认的epoll
+ * @return 每秒往返次数
+ */
+static double runBackend(const char *env, uint16_t port, int connections, int seconds, size_t msgSize)
+{
+    ::unsetenv("MUDUO_USE_POLL");
+    ::unsetenv("MUDUO_USE_IO_URING");
+    ::unsetenv("MUDUO_IO_URING_COMPLETION");
+    if (env != nullptr)
+    {
+        ::setenv(env, "1", 1);
+    }
+
+    BenchServer server(port, "EchoServer", [](TcpServer *s)
+                       {
+        s->setConnectionCallback([](const TcpConnectionPtr &) {});
+        s->setMessageCallback(onMessage); });
+
+    int64_t ctls = EpollPoller::numEpollCtls();
+    int64_t skipped = EpollPoller::numSkippedCtls();
+    long roundTrips = runEchoClients(port, connections, seconds, msgSize);
+    if (env == nullptr)
+    {
+        ctls = EpollPoller::numEpollCtls() - ctls;
+        skipped = EpollPoller::numSkippedCtls() - skipped;
+        benchResult("epoll: epoll_ctl/request=%.3f skipped/request=%.3f\n",
+                    static_cast<double>(ctls) / std::max(roundTrips, 1L),
+                    static_cast<double>(skipped) / std::max(roundTrips, 1L));
+    }
+    return static_cast<double>(roundTrips) / seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    int connections = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    size_t msgSize = argc > 3 ? static_cast<size_t>(atoi(argv[3])) : 64;
+
+    double epoll = runBackend(nullptr, 9983, connections, seconds, msgSize);
+    double poll = runBackend("MUDUO_USE_POLL", 9984, connections, seconds, msgSize);
+    // 内核不支持io_uring时newDefaultPolle会回退到epoll，日志中有提示
+    double uring = runBackend("MUDUO_USE_IO_URING", 9985, connections, seconds, msgSize);
+    double completion = runBackend("MUDUO_IO_URING_COMPLETION", 9982, connections, seconds, msgSize);
+
+    benchResult("connections=%d msgsize=%zu round trips/sec: epoll=%.0f poll=%.0f io_uring=%.0f io_uring completion=%.0f\n",
+                connections, msgSize, epoll, poll, uring, completion);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// 红黑树(SetTimerQueue)与分层时间轮(WheelTimerQueue)两种定时器队列的对比
+// 用法: timer_queue_bench [定时器数量...]，默认依次测试10000 1000000 10000000
+// 对每个数量：插入n个在60秒内随机到期的一次性定时器，取消其中一半，
+// 再以1ms为步长推进时间直到全部到期。时间是模拟的，不真正等待，统计每个操作的平均耗时。
+#include "BenchUtil.h"
+#include "../EventLoop.h"
+#include "../TimerQueue.h"
+#include "../TimerId.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+static long g_fired = 0;
+
+static void onTimer()
+{
+    ++g_fired;
+}
+
+static double nsSince(std::chrono::steady_clock::time_point start, long ops)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / ops;
+}
+
+/**
+ * @brief 用指定的实现测试一轮，结果写入line
+ */
+static void runOnce(EventLoop *loop, bool wheel, long n, std::string *line)
+{
+    if (wheel)
+    {
+        ::setenv("MUDUO_USE_TIMER_WHEEL", "1", 1);
+    }
+    else
+    {
+        ::unsetenv("MUDUO_USE_TIMER_WHEEL");
+    }
+    // 不使用timerfd，由这里直接调用processExpired推进时间
+    std::unique_ptr<TimerQueue> queue(TimerQueue::newDefaultTimerQueue(loop, false));
+
+    const int64_t spanUs = 60LL * Timestamp::kMicroSecondsPerSecond;
+    const int64_t base = MonotonicTime::now().microSeconds();
+    std::vector<TimerId> ids;
+    ids.reserve(n);
+    uint64_t seed = 88172645463325252ULL;
+    g_fired = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; ++i)
+    {
+        // xorshift生成均匀分布的到期时间
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        ids.push_back(queue->addTimer(onTimer, MonotonicTime((base + static_cast<int64_t>(seed % spanUs)) * 1000), 0.0));
+    }
+    double insertNs = nsSince(start, n);
+
+    start = std::chrono::steady_clock::now();
+    for (long i = 0; i < n; i += 2)
+    {
+        queue->cancel(ids[i]);
+    }
+    double cancelNs = nsSince(start, (n + 1) / 2);
+
+    start = std::chrono::steady_clock::now();
+    for (int64_t now = base; now <= base + spanUs + 1000; now += 1000)
+    {
+        queue->processExpired(MonotonicTime(now * 1000));
+    }
+    double expireNs = nsSince(start, std::max(g_fired, 1L));
+
+    char buf[160];
+    snprintf(buf, sizeof buf, "n=%-9ld %-5s insert=%6.0f ns  cancel=%6.0f ns  expire=%6.0f ns/timer  fired=%ld",
+             n, wheel ? "wheel" : "set", insertNs, cancelNs, expireNs, g_fired);
+    *line = buf;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<long> sizes;
+    for (int i = 1; i < argc; ++i)
+    {
+        sizes.push_back(atol(argv[i]));
+    }
+    if (sizes.empty())
+    {
+        sizes = {10000, 1000000, 10000000};
+    }
+
+    EventLoop loop;
+    std::vector<std::string> results;
+    for (long n : sizes)
+    {
+        for (int wheel = 0; wheel <= 1; ++wheel)
+        {
+            std::string line;
+            runOnce(&loop, wheel, n, &line);
+            results.push_back(line);
+        }
+    }
+    for (const std::string &line : results)
+    {
+        benchResult("%s\n", line.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,191 @@
+#include "CoConnection.h"
+#include "../TcpConnection.h"
+#include "../Buffer.h"
+#include "../Timestamp.h"
+
+CoConnection::CoConnection(const TcpConnectionPtr &conn)
+    : conn_(conn),
+      state_(std::make_shared<State>())
+{
+    state_->mode = kReadSome;
+    state_->n = 0;
+    state_->closed = !conn->connected();
+    state_->detached = false;
+
+    // 回调只持有State，不持有CoConnection，CoConnection随协程帧一起销毁。
+    // 通常在连接回调中构造，TcpConnection调用的是connectionCallback_的副本，这里可以直接替换
+    std::shared_ptr<State> state = state_;
+    conn_->setMessageCallback([state](const TcpConnectionPtr &c, Buffer *buf, Timestamp)
+                              { onMessage(state, c, buf); });
+    conn_->setWriteCompleteCallback([state](const TcpConnectionPtr &c)
+                                    { onWriteComplete(state, c); });
+    conn_->setConnectionCallback([state](const TcpConnectionPtr &c)
+                                 { onConnection(state, c); });
+}
+
+/**
+ * @brief 回调仍然留在TcpConnection上，之后到达的数据直接丢弃
+ */
+CoConnection::~CoConnection()
+{
+    state_->detached = true;
+    state_->reader = nullptr;
+    state_->writer = nullptr;
+}
+
+bool CoConnection::connected() const
+{
+    return !state_->closed && conn_->connected();
+}
+
+void CoConnection::shutdown()
+{
+    conn_->shutdown();
+}
+
+CoConnection::WriteAwaiter CoConnection::write(std::string_view data)
+{
+    if (connected())
+    {
+        conn_->send(data.data(), data.size());
+    }
+    return WriteAwaiter{this};
+}
+
+CoConnection::WriteAwaiter CoConnection::write(Buffer *buf)
+{
+    if (connected())
+    {
+        conn_->send(buf);
+    }
+    return WriteAwaiter{this};
+}
+
+/**
+ * @brief 输入缓冲区中的数据是否满足当前的读请求
+ */
+bool CoConnection::State::readable(Buffer *buf) const
+{
+    switch (mode)
+    {
+    case kReadExactly:
+        return buf->readableBytes() >= n;
+    case kReadUntil:
+        return std::string_view(buf->peek(), buf->readableBytes()).find(delim) != std::string_view::npos;
+    default:
+        return buf->readableBytes() > 0;
+    }
+}
+
+/**
+ * @brief 从输入缓冲区中取出满足读请求的数据
+ */
+std::string CoConnection::State::take(Buffer *buf)
+{
+    switch (mode)
+    {
+    case kReadExactly:
+        return buf->retrieveAllAsString(n);
+    case kReadUntil:
+    {
+        size_t pos = std::string_view(buf->peek(), buf->readableBytes()).find(delim);
+        return buf->retrieveAllAsString(pos + delim.size());
+    }
+    default:
+        return buf->retrieveAllAsString();
+    }
+}
+
+bool CoConnection::ReadAwaiter::await_ready()
+{
+    State &state = *conn->state_;
+    state.mode = mode;
+    state.n = n;
+    state.delim.swap(delim);
+    return state.closed || state.readable(conn->conn_->inputBuffer());
+}
+
+void CoConnection::ReadAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    conn->state_->reader = h;
+}
+
+std::string CoConnection::ReadAwaiter::await_resume()
+{
+    State &state = *conn->state_;
+    Buffer *buf = conn->conn_->inputBuffer();
+    if (state.readable(buf))
+    {
+        return state.take(buf);
+    }
+    return std::string(); // 连接已经关闭
+}
+
+bool CoConnection::WriteAwaiter::await_ready()
+{
+    return conn->state_->closed || conn->conn_->outputBuffer()->readableBytes() == 0;
+}
+
+void CoConnection::WriteAwaiter::await_suspend(std::coroutine_handle<> h)
+{
+    conn->state_->writer = h;
+}
+
+bool CoConnection::WriteAwaiter::await_resume() const
+{
+    return !conn->state_->closed;
+}
+
+/**
+ * @brief 在TcpConnection::handleRead中被调用，满足读请求时直接恢复等待的协程
+ */
+void CoConnection::onMessage(const std::shared_ptr<State> &state, const TcpConnectionPtr &, Buffer *buf)
+{
+    if (state->detached)
+    {
+        buf->retrieveAll();
+        return;
+    }
+    if (state->reader && state->readable(buf))
+    {
+        std::coroutine_handle<> h = state->reader;
+        state->reader = nullptr;
+        h.resume();
+    }
+}
+
+void CoConnection::onWriteComplete(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn)
+{
+    // 之前直接写完的数据也会排队触发writeComplete，需要确认输出缓冲区确实已经清空
+    if (state->writer && conn->outputBuffer()->readableBytes() == 0)
+    {
+        std::coroutine_handle<> h = state->writer;
+        state->writer = nullptr;
+        h.resume();
+    }
+}
+
+/**
+ * @brief 连接断开时唤醒所有等待者，读返回空串、写返回false
+ */
+void CoConnection::onConnection(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        return;
+    }
+    state->closed = true;
+    std::coroutine_handle<> reader = state->reader;
+    std::coroutine_handle<> writer = state->writer;
+    state->reader = nullptr;
+    state->writer = nullptr;
+    if (reader)
+    {
+        reader.resume();
+    }
+    // reader恢复后CoConnection可能已经析构
+    if (writer && !state->detached)
+    {
+        writer.resume();
+    }
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "../noncopyable.h"
+#include "../CallBacks.h"
+
+#include <coroutine>
+#include <memory>
+#include <string>
+#include <string_view>
+
+class Buffer;
+
+/**
+ * @brief TcpConnection的协程适配层。
+ * 构造时接管连接的message/writeComplete/connection回调，之后可以
+ *   co_await conn.read(n)、co_await conn.readUntil("\r\n")、co_await conn.readSome()、co_await conn.write(buf)
+ * 等待中的协程直接在Channel的读写回调（TcpConnection::handleRead等）中被恢复，不经过任务队列。
+ * CoConnection只能在连接所属loop的线程中使用。
+ */
+class CoConnection : noncopyable
+{
+public:
+    explicit CoConnection(const TcpConnectionPtr &conn);
+    ~CoConnection();
+
+    const TcpConnectionPtr &connection() const { return conn_; }
+    bool connected() const;
+    void shutdown();
+
+private:
+    enum ReadMode
+    {
+        kReadExactly, // read(n)
+        kReadUntil,   // readUntil(delim)
+        kReadSome,    // readSome()
+    };
+
+    /**
+     * @brief 与TcpConnection回调共享的状态。CoConnection析构后回调仍可能被调用，所以用shared_ptr管理
+     */
+    struct State
+    {
+        std::coroutine_handle<> reader; // 等待读的协程
+        std::coroutine_handle<> writer; // 等待写完成的协程
+        ReadMode mode;
+        size_t n;
+        std::string delim;
+        bool closed;
+        bool detached; // CoConnection已经析构
+
+        bool readable(Buffer *buf) const;
+        std::string take(Buffer *buf);
+    };
+
+public:
+    struct ReadAwaiter
+    {
+        CoConnection *conn;
+        ReadMode mode;
+        size_t n;
+        std::string delim;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        std::string await_resume();
+    };
+
+    struct WriteAwaiter
+    {
+        CoConnection *conn;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h);
+        bool await_resume() const;
+    };
+
+    /**
+     * @brief 读取恰好n个字节。连接关闭且数据不足时返回空串
+     */
+    ReadAwaiter read(size_t n) { return ReadAwaiter{this, kReadExactly, n, std::string()}; }
+
+    /**
+     * @brief 读取到delim为止（包含delim）。连接关闭且没有遇到delim时返回空串
+     */
+    ReadAwaiter readUntil(std::string_view delim) { return ReadAwaiter{this, kReadUntil, 0, std::string(delim)}; }
+
+    /**
+     * @brief 读取当前已经到达的全部数据。连接关闭时返回空串
+     */
+    ReadAwaiter readSome() { return ReadAwaiter{this, kReadSome, 0, std::string()}; }
+
+    /**
+     * @brief 发送数据，数据全部交给内核后恢复。返回false表示连接已经关闭
+     */
+    WriteAwaiter write(std::string_view data);
+    WriteAwaiter write(Buffer *buf);
+
+private:
+    static void onMessage(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn, Buffer *buf);
+    static void onWriteComplete(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn);
+    static void onConnection(const std::shared_ptr<State> &state, const TcpConnectionPtr &conn);
+
+    TcpConnectionPtr conn_;
+    std::shared_ptr<State> state_;
+};
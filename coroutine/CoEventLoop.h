@@ -0,0 +1,59 @@
+#pragma once
+
+#include "../EventLoop.h"
+
+#include <coroutine>
+
+/**
+ * @brief EventLoop的协程适配层，提供co_await loop.sleep(ms)与co_await loop.switchTo(other)。
+ * sleep由TimerQueue的定时器回调直接恢复协程；lambda只捕获一个coroutine_handle，
+ * 放得进std::function的小对象缓冲区，不会额外分配内存。
+ */
+class CoEventLoop
+{
+public:
+    explicit CoEventLoop(EventLoop *loop) : loop_(loop) {}
+
+    EventLoop *loop() const { return loop_; }
+
+    struct SleepAwaiter
+    {
+        EventLoop *loop;
+        int ms;
+
+        bool await_ready() const noexcept { return ms <= 0; }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            loop->runAfter(ms / 1000.0, [h]()
+                           { h.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct SwitchAwaiter
+    {
+        EventLoop *target;
+
+        // 已经在目标loop的线程中则不挂起
+        bool await_ready() const noexcept { return target->isInLoopThread(); }
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            target->queueInLoop([h]()
+                                { h.resume(); });
+        }
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief 挂起当前协程ms毫秒，之后在loop_的线程中恢复
+     */
+    SleepAwaiter sleep(int ms) const { return SleepAwaiter{loop_, ms}; }
+
+    /**
+     * @brief 把当前协程迁移到other的线程中继续执行
+     */
+    static SwitchAwaiter switchTo(EventLoop *other) { return SwitchAwaiter{other}; }
+
+private:
+    EventLoop *loop_;
+};
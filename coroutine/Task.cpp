@@ -0,0 +1,26 @@
+#include "Task.h"
+#include "../Logger.h"
+
+namespace detail
+{
+    void DetachedTask::promise_type::unhandled_exception()
+    {
+        try
+        {
+            throw;
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("co_spawn: coroutine exited with exception: %s \n", e.what());
+        }
+        catch (...)
+        {
+            LOG_ERROR("co_spawn: coroutine exited with unknown exception \n");
+        }
+    }
+
+    DetachedTask runDetached(Task<void> task)
+    {
+        co_await std::move(task);
+    }
+}
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/**
+ * C++20协程层的基础：惰性启动的Task<T>。
+ * co_await一个Task时才开始执行，结束时通过对称转移(symmetric transfer)直接恢复等待者，
+ * 不经过EventLoop的任务队列、也不会额外切换线程。
+ */
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+    struct TaskPromiseBase
+    {
+        /**
+         * @brief Task结束时恢复等待它的协程
+         */
+        struct FinalAwaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            template <typename Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+            {
+                std::coroutine_handle<> continuation = h.promise().continuation_;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { exception_ = std::current_exception(); }
+
+        std::coroutine_handle<> continuation_; // 等待当前Task的协程
+        std::exception_ptr exception_;
+    };
+
+    template <typename T>
+    struct TaskPromise : TaskPromiseBase
+    {
+        Task<T> get_return_object();
+
+        template <typename U>
+        void return_value(U &&value) { value_.emplace(std::forward<U>(value)); }
+
+        T result()
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+            return std::move(*value_);
+        }
+
+        std::optional<T> value_;
+    };
+
+    template <>
+    struct TaskPromise<void> : TaskPromiseBase
+    {
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void result()
+        {
+            if (exception_)
+            {
+                std::rethrow_exception(exception_);
+            }
+        }
+    };
+}
+
+template <typename T>
+class Task
+{
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle h) : handle_(h) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_)
+            {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+
+    ~Task()
+    {
+        if (handle_)
+        {
+            handle_.destroy();
+        }
+    }
+
+    /**
+     * @brief co_await task：启动task、task结束后恢复当前协程
+     */
+    auto operator co_await() && noexcept
+    {
+        struct Awaiter
+        {
+            Handle handle;
+
+            bool await_ready() const noexcept
+            {
+                // co_await一个被移动过的空Task是使用错误，没有结果可以返回
+                if (!handle)
+                {
+                    std::terminate();
+                }
+                return handle.done();
+            }
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                handle.promise().continuation_ = awaiting;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    Handle handle_;
+};
+
+namespace detail
+{
+    template <typename T>
+    inline Task<T> TaskPromise<T>::get_return_object()
+    {
+        return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> TaskPromise<void>::get_return_object()
+    {
+        return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+    }
+
+    /**
+     * @brief 自行销毁的协程、用来承载co_spawn启动的顶层Task
+     */
+    struct DetachedTask
+    {
+        struct promise_type
+        {
+            DetachedTask get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception();
+        };
+    };
+
+    DetachedTask runDetached(Task<void> task);
+}
+
+/**
+ * @brief 在当前线程中立即启动一个顶层协程，协程结束后自动释放。
+ * 协程内未捕获的异常会被记录到日志中
+ */
+inline void co_spawn(Task<void> task)
+{
+    detail::runDetached(std::move(task));
+}
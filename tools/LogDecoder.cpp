@@ -0,0 +1,205 @@
+// 二进制日志文件(AsyncLogging::kBinary)的离线解码工具，输出与文本日志相同格式的行
+// 用法: log_decoder 日志文件... > out.log
+// 加上-v时在每行末尾附加调用处的文件名和行号
+#include "../BinaryLog.h"
+#include "../Logger.h"
+#include "../Timestamp.h"
+#include "../TimestampFormatter.h"
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+     * @brief 顺序读取文件内容，越界时ok()变为false
+     */
+    class Reader
+    {
+    public:
+        Reader(const char *data, size_t len) : data_(data), end_(data + len), ok_(true) {}
+
+        template <typename T>
+        T read()
+        {
+            T value = T();
+            if (static_cast<size_t>(end_ - data_) < sizeof value)
+            {
+                ok_ = false;
+                return value;
+            }
+            memcpy(&value, data_, sizeof value);
+            data_ += sizeof value;
+            return value;
+        }
+
+        // uint32长度加内容
+        std::string readBytes()
+        {
+            uint32_t len = read<uint32_t>();
+            if (!ok_ || static_cast<size_t>(end_ - data_) < len)
+            {
+                ok_ = false;
+                return std::string();
+            }
+            std::string bytes(data_, len);
+            data_ += len;
+            return bytes;
+        }
+
+        bool ok() const { return ok_; }
+        bool atEnd() const { return data_ == end_; }
+
+    private:
+        const char *data_;
+        const char *end_;
+        bool ok_;
+    };
+
+    struct Format
+    {
+        int level;
+        int line;
+        std::string fmt;
+        std::string file;
+        std::string signature;
+    };
+
+    bool readFile(const char *path, std::string *content)
+    {
+        FILE *fp = fopen(path, "rb");
+        if (fp == nullptr)
+        {
+            perror(path);
+            return false;
+        }
+        char buf[64 * 1024];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof buf, fp)) > 0)
+        {
+            content->append(buf, n);
+        }
+        fclose(fp);
+        return true;
+    }
+
+    /**
+     * @brief 解码一个文件，格式表只在文件内有效。返回是否完整解码
+     */
+    bool decode(const char *path, bool verbose)
+    {
+        std::string content;
+        if (!readFile(path, &content))
+        {
+            return false;
+        }
+        const size_t magicLen = sizeof BinaryLog::kFileMagic - 1;
+        if (content.size() < magicLen || memcmp(content.data(), BinaryLog::kFileMagic, magicLen) != 0)
+        {
+            fprintf(stderr, "%s: not a binary log file\n", path);
+            return false;
+        }
+
+        std::map<int32_t, Format> formats;
+        Reader reader(content.data() + magicLen, content.size() - magicLen);
+        char line[1024 + 64];
+        while (reader.ok() && !reader.atEnd())
+        {
+            const char type = reader.read<char>();
+            if (type == BinaryLog::kFormatEntry)
+            {
+                int32_t id = reader.read<int32_t>();
+                Format &format = formats[id];
+                format.level = reader.read<int32_t>();
+                format.line = reader.read<int32_t>();
+                format.fmt = reader.readBytes();
+                format.file = reader.readBytes();
+                format.signature = reader.readBytes();
+            }
+            else if (type == BinaryLog::kBinaryEntry)
+            {
+                int64_t microSecondsSinceEpoch = reader.read<int64_t>();
+                int32_t id = reader.read<int32_t>();
+                std::string args = reader.readBytes();
+                if (!reader.ok())
+                {
+                    break;
+                }
+                auto it = formats.find(id);
+                if (it == formats.end())
+                {
+                    fprintf(stderr, "%s: unknown format id %d\n", path, id);
+                    continue;
+                }
+                const Format &format = it->second;
+                const char *tag = Logger::levelTag(format.level);
+                size_t n = strlen(tag);
+                memcpy(line, tag, n);
+                n += TimestampFormatter::format(Timestamp(microSecondsSinceEpoch), TimestampFormatter::kSlash, false,
+                                                line + n);
+                memcpy(line + n, " : ", 3);
+                n += 3;
+                n += BinaryLog::formatArgs(format.fmt.c_str(), format.signature.c_str(), args.data(), args.size(),
+                                           line + n, sizeof line - n);
+                fwrite(line, 1, n, stdout);
+                if (verbose)
+                {
+                    printf(" (%s:%d)", format.file.c_str(), format.line);
+                }
+                putchar('\n');
+            }
+            else if (type == BinaryLog::kTextEntry)
+            {
+                std::string text = reader.readBytes();
+                fwrite(text.data(), 1, text.size(), stdout);
+            }
+            else
+            {
+                fprintf(stderr, "%s: bad entry type 0x%02x\n", path, static_cast<unsigned char>(type));
+                return false;
+            }
+        }
+        if (!reader.ok())
+        {
+            // 进程崩溃时最后一个条目可能不完整
+            fprintf(stderr, "%s: truncated entry at end of file\n", path);
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool verbose = false;
+    std::vector<const char *> files;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-v") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty())
+    {
+        fprintf(stderr, "usage: %s [-v] binary-log-file...\n", argv[0]);
+        return 2;
+    }
+
+    int status = 0;
+    for (const char *file : files)
+    {
+        if (!decode(file, verbose))
+        {
+            status = 1;
+        }
+    }
+    return status;
+}